@@ -0,0 +1,63 @@
+# Standalone benchmark of the plugin, built against the stand-ins of OpenZWave and
+# libnymea in stubs/ so it runs without a Z-Wave stick or a nymea core:
+#   qmake benchmark/benchmark.pro && make && ./zwave-benchmark --help
+
+TEMPLATE = app
+TARGET = zwave-benchmark
+
+QT += serialport
+QT -= gui
+
+CONFIG += c++14 console link_pkgconfig
+CONFIG -= app_bundle
+PKGCONFIG += libudev
+
+INCLUDEPATH += $$PWD/stubs $$PWD/stubs/nymea $$PWD/..
+
+CONFIG_PATH=/etc/openzwave/
+DEFINES += CONFIG_PATH=\\\"$${CONFIG_PATH}\\\"
+
+SOURCES += \
+    main.cpp \
+    stubs/openzwave/Manager.cpp \
+    ../integrationpluginzwave.cpp \
+    ../zwavecommandqueue.cpp \
+    ../zwavecontroller.cpp \
+    ../zwavedeviceclass.cpp \
+    ../zwaveliveness.cpp \
+    ../zwavemanager.cpp \
+    ../zwavemetrics.cpp \
+    ../zwavenode.cpp \
+    ../zwavenotificationqueue.cpp \
+    ../zwavepollscheduler.cpp \
+    ../zwaveserialportindex.cpp \
+    ../zwavesimulator.cpp \
+    ../zwavestatebindings.cpp \
+    ../zwavetopology.cpp \
+    ../zwavetrace.cpp \
+    ../zwavevalue.cpp \
+    ../zwavevaluehistory.cpp
+
+HEADERS += \
+    stubs/nymea/integrations/integrationplugin.h \
+    stubs/nymea/integrations/thing.h \
+    stubs/nymea/integrations/thingactioninfo.h \
+    stubs/nymea/integrations/thingdiscoveryinfo.h \
+    stubs/nymea/integrations/thingsetupinfo.h \
+    ../integrationpluginzwave.h \
+    ../zwavecommandqueue.h \
+    ../zwavecontroller.h \
+    ../zwavedeviceclass.h \
+    ../zwaveliveness.h \
+    ../zwavemanager.h \
+    ../zwavemetrics.h \
+    ../zwavenode.h \
+    ../zwavenotificationqueue.h \
+    ../zwavepollscheduler.h \
+    ../zwaveserialportindex.h \
+    ../zwavesimulator.h \
+    ../zwavestatebindings.h \
+    ../zwavetopology.h \
+    ../zwavetrace.h \
+    ../zwavevalue.h \
+    ../zwavevaluehistory.h
@@ -0,0 +1,707 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+// Notification storm and scene benchmark of the plugin. The plugin and ZwaveManager run
+// unmodified on top of stand-ins of OpenZWave and libnymea (see stubs/). A thread plays
+// the OpenZWave driver: it interviews a virtual network and then feeds value changes to
+// the watcher, just like a stick would. With --replay the driver thread feeds a trace
+// recorded with NYMEA_ZWAVE_TRACE instead. Allocations are counted by wrapping malloc.
+
+#include "integrationpluginzwave.h"
+#include "extern-plugininfo.h"
+#include "zwavetrace.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QThread>
+#include <QTimer>
+#include <QDir>
+
+#include "nymeasettings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// glibc only: every allocation, operator new and Qt containers included, ends up here
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+}
+
+static std::atomic<quint64> s_allocations(0);
+static thread_local quint64 t_allocations = 0;
+
+static inline void countAllocation()
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    t_allocations++;
+}
+
+extern "C" void *malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer)
+{
+    __libc_free(pointer);
+}
+
+using namespace OpenZWave;
+
+struct Configuration {
+    int nodes = 50;
+    int values = 20;
+    int rate = 1000; // Notifications per second
+    int duration = 10; // Seconds
+    int coalescing = 0; // Milliseconds
+    int scenes = 20;
+    int reads = 100; // Rounds over all values
+    QString replay; // Trace file, replaces the synthetic network
+    double speed = 1; // Factor of the recorded pace, 0 is as fast as possible
+};
+
+static const quint32 homeId = 0xc0ffee01;
+
+static bool waitFor(const std::function<bool()> &condition, int timeout)
+{
+    if (condition())
+        return true;
+
+    QEventLoop loop;
+    QTimer poll;
+    poll.setInterval(5);
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (condition()) {
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(timeout, &loop, &QEventLoop::quit);
+    poll.start();
+    loop.exec();
+    return condition();
+}
+
+static QString percentiles(QVector<qint64> samples)
+{
+    if (samples.isEmpty())
+        return "no samples";
+
+    std::sort(samples.begin(), samples.end());
+    qint64 p50 = samples.at(samples.count() / 2);
+    qint64 p99 = samples.at(qMin(samples.count() - 1, samples.count() * 99 / 100));
+    return QString("p50 %1 us p99 %2 us max %3 us").arg(p50 / 1000).arg(p99 / 1000).arg(samples.last() / 1000);
+}
+
+// The values of a node: the ones the plug thing binds to, then configuration parameters
+static QList<ValueID> nodeValueIds(quint8 nodeId, int count)
+{
+    QList<ValueID> valueIds;
+    valueIds.append(ValueID(homeId, nodeId, ValueID::ValueGenre_User, 0x25, 1, 0, ValueID::ValueType_Bool));
+    valueIds.append(ValueID(homeId, nodeId, ValueID::ValueGenre_User, 0x32, 1, 0, ValueID::ValueType_Decimal));
+    valueIds.append(ValueID(homeId, nodeId, ValueID::ValueGenre_User, 0x32, 1, 2, ValueID::ValueType_Decimal));
+    for (int i = 3; i < count; i++) {
+        valueIds.append(ValueID(homeId, nodeId, ValueID::ValueGenre_Config, 0x70, 1, static_cast<quint16>(i), ValueID::ValueType_Byte));
+    }
+    return valueIds;
+}
+
+static const int powerValueIndex = 2;
+
+class Benchmark : public QObject
+{
+public:
+    Benchmark(const Configuration &configuration) :
+        m_configuration(configuration)
+    {
+        m_clock.start();
+    }
+
+    ~Benchmark()
+    {
+        if (m_driver.joinable()) {
+            m_stop = true;
+            m_driver.join();
+        }
+        if (m_pty >= 0) {
+            ::close(m_pty);
+        }
+    }
+
+    bool run()
+    {
+        if (!openPort())
+            return false;
+
+        m_plugin = new IntegrationPluginZwave();
+        m_plugin->setConfigValue(zwavePluginValueCoalescingWindowParamTypeId, m_configuration.coalescing);
+        m_plugin->setConfigValue(zwavePluginPollBudgetParamTypeId, 60);
+        connect(m_plugin, &IntegrationPlugin::autoThingsAppeared, this, [this](const ThingDescriptors &descriptors) {
+            foreach (const ThingDescriptor &descriptor, descriptors) {
+                addThing(descriptor);
+            }
+        });
+
+        bool success = false;
+        if (!m_configuration.replay.isEmpty()) {
+            success = setupInterface() && replay();
+        } else {
+            success = setup() && storm() && scenes() && reads();
+        }
+        teardown();
+        return success;
+    }
+
+private:
+    Configuration m_configuration;
+    QElapsedTimer m_clock;
+    int m_pty = -1;
+    QString m_path;
+
+    IntegrationPluginZwave *m_plugin = nullptr;
+    Thing *m_interface = nullptr;
+    ThingSetupInfo *m_interfaceSetup = nullptr;
+    QList<Thing *> m_plugs;
+    QHash<Thing *, int> m_plugNodes;
+
+    std::thread m_driver;
+    std::atomic<bool> m_stop {false};
+    std::atomic<bool> m_driverDone {false};
+    QList<ValueID> m_valueIds;
+
+    bool openPort()
+    {
+        // ZwaveManager only accepts existing ports, pseudo terminals are fine
+        m_pty = posix_openpt(O_RDWR | O_NOCTTY);
+        if (m_pty < 0 || grantpt(m_pty) < 0 || unlockpt(m_pty) < 0) {
+            qCWarning(dcZwave()) << "ZwaveBenchmark: Could not open a pseudo terminal";
+            return false;
+        }
+        m_path = QString::fromLatin1(ptsname(m_pty));
+        return true;
+    }
+
+    void addThing(const ThingDescriptor &descriptor)
+    {
+        // What the thing manager of the core does with auto things
+        Thing *thing = new Thing(descriptor.thingClassId(), descriptor.title(), descriptor.params(), descriptor.parentId(), m_plugin);
+        m_plugin->addMyThing(thing);
+        ThingSetupInfo info(thing);
+        m_plugin->setupThing(&info);
+        if (info.status() != Thing::ThingErrorNoError) {
+            qCWarning(dcZwave()) << "ZwaveBenchmark: Setup of" << thing->name() << "failed" << info.status();
+            m_plugin->removeMyThing(thing);
+            delete thing;
+            return;
+        }
+        m_plugin->postSetupThing(thing);
+        if (thing->thingClassId() == plugThingClassId) {
+            m_plugs.append(thing);
+            m_plugNodes.insert(thing, thing->paramValue(plugThingIdParamTypeId).toInt());
+        }
+    }
+
+    bool setupInterface()
+    {
+        ParamList params;
+        params.append(Param(interfaceThingPathParamTypeId, m_path));
+        params.append(Param(interfaceThingSerialNumberParamTypeId, QString()));
+        m_interface = new Thing(interfaceThingClassId, "Benchmark interface", params, ThingId(), m_plugin);
+        m_plugin->addMyThing(m_interface);
+
+        m_interfaceSetup = new ThingSetupInfo(m_interface, this);
+        m_plugin->setupThing(m_interfaceSetup);
+        if (m_interfaceSetup->isFinished() && m_interfaceSetup->status() != Thing::ThingErrorNoError) {
+            qCWarning(dcZwave()) << "ZwaveBenchmark: Setup of the interface failed" << m_interfaceSetup->status();
+            return false;
+        }
+        return true;
+    }
+
+    bool setup()
+    {
+        if (!setupInterface())
+            return false;
+        ThingSetupInfo &info = *m_interfaceSetup;
+
+        for (int i = 0; i < m_configuration.nodes; i++) {
+            m_valueIds.append(nodeValueIds(static_cast<quint8>(i + 2), m_configuration.values));
+        }
+
+        // The interview of the virtual network, paced so the notification queue never overflows
+        QElapsedTimer timer;
+        timer.start();
+        m_driver = std::thread([this]() {
+            Manager *manager = Manager::Get();
+            manager->StubDriverReady(m_path.toStdString(), homeId);
+            int sent = 0;
+            for (int i = 0; i < m_configuration.nodes && !m_stop; i++) {
+                quint8 nodeId = static_cast<quint8>(i + 2);
+                Manager::StubNode node;
+                node.name = "Plug " + std::to_string(nodeId);
+                node.manufacturerName = "FIBARO System";
+                node.manufacturerId = "0x010f";
+                node.productType = "0x0600";
+                node.productId = "0x1000";
+                node.productName = "FGWPE/F Wall Plug";
+                node.generic = 0x10;
+                node.specific = 0x01;
+                manager->StubAddNode(homeId, nodeId, node);
+                manager->StubNotify(Notification(Notification::Type_NodeAdded, ValueID(homeId, nodeId)));
+
+                QList<ValueID> valueIds = nodeValueIds(nodeId, m_configuration.values);
+                for (int v = 0; v < valueIds.count(); v++) {
+                    static const char *labels[] = { "Switch", "Energy", "Power" };
+                    manager->StubAddValue(valueIds.at(v), 0, v <= powerValueIndex ? labels[v] : "Parameter");
+                    manager->StubNotify(Notification(Notification::Type_ValueAdded, valueIds.at(v)));
+                    if (++sent % 32 == 0) {
+                        QThread::usleep(1000);
+                    }
+                }
+                manager->StubNotify(Notification(Notification::Type_NodeQueriesComplete, ValueID(homeId, nodeId)));
+            }
+            manager->StubNotify(Notification(Notification::Type_AllNodesQueried, ValueID(homeId, static_cast<quint8>(1))));
+        });
+
+        bool ready = waitFor([&]() { return info.isFinished() && m_plugs.count() == m_configuration.nodes; }, 60000);
+        m_driver.join();
+        if (!ready) {
+            qCWarning(dcZwave()) << "ZwaveBenchmark: Interview did not finish," << m_plugs.count() << "of" << m_configuration.nodes << "plugs set up";
+            return false;
+        }
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Interviewed" << m_configuration.nodes << "nodes with" << m_configuration.values << "values each in" << timer.elapsed() << "ms";
+        return true;
+    }
+
+    bool storm()
+    {
+        const qint64 total = static_cast<qint64>(m_configuration.rate) * m_configuration.duration;
+        const int valueCount = m_valueIds.count();
+
+        // Send time of every notification, the value is the sequence number
+        QVector<qint64> sendTimes(static_cast<int>(total), 0);
+        qint64 *sendTime = sendTimes.data();
+        QVector<qint64> latencies;
+        latencies.reserve(static_cast<int>(total));
+
+        // The last sequence number sent to each power value, complete once all of them arrived
+        QHash<Thing *, qint64> expected;
+        QHash<Thing *, qint64> received;
+        for (qint64 sequence = 0; sequence < total; sequence++) {
+            int index = static_cast<int>(sequence % valueCount);
+            if (index % m_configuration.values == powerValueIndex) {
+                expected[m_plugs.at(index / m_configuration.values)] = sequence;
+            }
+        }
+
+        foreach (Thing *plug, m_plugs) {
+            connect(plug, &Thing::stateValueChanged, this, [&, plug](const StateTypeId &stateTypeId, const QVariant &value) {
+                if (stateTypeId != plugCurrentPowerStateTypeId)
+                    return;
+                qint64 sequence = qRound64(value.toDouble());
+                if (sequence < 0 || sequence >= total)
+                    return;
+                latencies.append(m_clock.nsecsElapsed() - sendTime[sequence]);
+                received[plug] = sequence;
+            });
+        }
+
+        quint64 driverAllocations = 0;
+        qint64 sendDuration = 0;
+        m_driverDone = false;
+        quint64 allocations = t_allocations;
+        QElapsedTimer timer;
+        timer.start();
+
+        // Paced in slices of one millisecond, round robin over all values of all nodes
+        m_driver = std::thread([&]() {
+            Manager *manager = Manager::Get();
+            quint64 startAllocations = t_allocations;
+            QElapsedTimer clock;
+            clock.start();
+            qint64 sent = 0;
+            while (sent < total && !m_stop) {
+                qint64 due = qMin(total, clock.nsecsElapsed() * m_configuration.rate / 1000000000);
+                while (sent < due) {
+                    const ValueID &valueId = m_valueIds.at(static_cast<int>(sent % valueCount));
+                    manager->StubSetValue(valueId, static_cast<double>(sent));
+                    sendTime[sent] = m_clock.nsecsElapsed();
+                    manager->StubNotify(Notification(Notification::Type_ValueChanged, valueId));
+                    sent++;
+                }
+                QThread::usleep(1000);
+            }
+            sendDuration = clock.elapsed();
+            driverAllocations = t_allocations - startAllocations;
+            m_driverDone = true;
+        });
+
+        bool complete = waitFor([&]() { return m_driverDone && received == expected; }, m_configuration.duration * 1000 + 10000);
+        qint64 elapsed = timer.elapsed();
+        allocations = t_allocations - allocations;
+        m_stop = true;
+        m_driver.join();
+        m_stop = false;
+
+        foreach (Thing *plug, m_plugs) {
+            disconnect(plug, &Thing::stateValueChanged, this, nullptr);
+        }
+
+        ZwaveManager *manager = m_plugin->findChild<ZwaveManager *>();
+        double seconds = sendDuration / 1000.0;
+        qCInfo(dcZwave()) << "ZwaveBenchmark:" << m_configuration.nodes << "nodes x" << m_configuration.values << "values at" << m_configuration.rate
+                          << "notifications/s, coalescing window" << m_configuration.coalescing << "ms";
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Sent" << total << "in" << seconds << "s, processed in" << elapsed << "ms,"
+                          << (manager ? manager->droppedNotifications(homeId) : 0) << "dropped" << (complete ? "" : "(incomplete)");
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Notification to thing state latency" << percentiles(latencies) << "over" << latencies.count() << "state changes";
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Allocations per notification" << QString::number(total > 0 ? static_cast<double>(allocations) / total : 0, 'f', 2)
+                          << "on the Qt thread," << QString::number(total > 0 ? static_cast<double>(driverAllocations) / total : 0, 'f', 2) << "on the driver thread";
+        return complete;
+    }
+
+    bool scenes()
+    {
+        // All plugs switched by one scene of a rule, confirmed by the stub Manager like a device would
+        QVector<qint64> latencies;
+        QVector<qint64> durations;
+        quint64 allocations = t_allocations;
+        int failed = 0;
+        int actions = 0;
+
+        for (int scene = 0; scene < m_configuration.scenes; scene++) {
+            QList<ThingActionInfo *> infos;
+            qint64 start = m_clock.nsecsElapsed();
+            foreach (Thing *plug, m_plugs) {
+                ParamList params;
+                params.append(Param(plugPowerActionPowerParamTypeId, scene % 2 == 0));
+                ThingActionInfo *info = new ThingActionInfo(plug, Action(plugPowerActionTypeId, plug->id(), params, Action::TriggeredByRule), this);
+                connect(info, &ThingActionInfo::finished, this, [this, info, start, &latencies, &failed]() {
+                    latencies.append(m_clock.nsecsElapsed() - start);
+                    if (info->status() != Thing::ThingErrorNoError) {
+                        failed++;
+                    }
+                });
+                infos.append(info);
+                m_plugin->executeAction(info);
+            }
+            actions += infos.count();
+
+            bool finished = waitFor([&]() {
+                return std::all_of(infos.constBegin(), infos.constEnd(), [](ThingActionInfo *info) { return info->isFinished(); });
+            }, 15000);
+            durations.append(m_clock.nsecsElapsed() - start);
+            qDeleteAll(infos);
+            if (!finished) {
+                qCWarning(dcZwave()) << "ZwaveBenchmark: Scene" << scene << "did not finish";
+                return false;
+            }
+        }
+        allocations = t_allocations - allocations;
+
+        qCInfo(dcZwave()) << "ZwaveBenchmark:" << m_configuration.scenes << "scenes switching" << m_plugs.count() << "plugs," << failed << "actions failed";
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Action latency" << percentiles(latencies) << ", scene duration" << percentiles(durations);
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Allocations per action" << QString::number(actions > 0 ? static_cast<double>(allocations) / actions : 0, 'f', 2);
+        return failed == 0;
+    }
+
+    // The value read of the plugin before values were cached, every read goes through the Manager lock
+    static QVariant managerValue(const ValueID &valueId)
+    {
+        switch (valueId.GetType()) {
+        case ValueID::ValueType_Bool: {
+            bool boolValue = false;
+            Manager::Get()->GetValueAsBool(valueId, &boolValue);
+            return QVariant(boolValue);
+        }
+        case ValueID::ValueType_Byte: {
+            quint8 byteValue = 0;
+            Manager::Get()->GetValueAsByte(valueId, &byteValue);
+            return QVariant(byteValue);
+        }
+        case ValueID::ValueType_Decimal: {
+            float floatValue = 0;
+            Manager::Get()->GetValueAsFloat(valueId, &floatValue);
+            return QVariant(floatValue);
+        }
+        case ValueID::ValueType_Int: {
+            qint32 intValue = 0;
+            Manager::Get()->GetValueAsInt(valueId, &intValue);
+            return QVariant(intValue);
+        }
+        case ValueID::ValueType_Short: {
+            qint16 shortValue = 0;
+            Manager::Get()->GetValueAsShort(valueId, &shortValue);
+            return QVariant(shortValue);
+        }
+        default:
+            return QVariant();
+        }
+    }
+
+    // Nanoseconds per read of all values of all nodes, once from the cache of the nodes and once
+    // through the Manager, first idle and then while the driver thread keeps updating values
+    bool reads()
+    {
+        ZwaveManager *zwaveManager = m_plugin->findChild<ZwaveManager *>();
+        if (!zwaveManager || m_configuration.reads <= 0)
+            return true;
+
+        QList<QPair<ZwaveNode *, ValueID>> values;
+        foreach (ZwaveNode *node, zwaveManager->nodes()) {
+            foreach (const ValueID &valueId, node->valueIds()) {
+                values.append(qMakePair(node, valueId));
+            }
+        }
+        if (values.isEmpty())
+            return true;
+
+        const double count = static_cast<double>(values.count()) * m_configuration.reads;
+        auto measure = [&](bool cached, quint64 *managerReads) {
+            quint64 startReads = Manager::Get()->StubValueReads();
+            double checksum = 0;
+            QElapsedTimer timer;
+            timer.start();
+            for (int round = 0; round < m_configuration.reads; round++) {
+                for (int i = 0; i < values.count(); i++) {
+                    const QPair<ZwaveNode *, ValueID> &value = values.at(i);
+                    QVariant variant = cached ? value.first->value(value.second.GetId()).toVariant() : managerValue(value.second);
+                    checksum += variant.toDouble();
+                }
+            }
+            qint64 elapsed = timer.nsecsElapsed();
+            *managerReads = Manager::Get()->StubValueReads() - startReads;
+            Q_UNUSED(checksum)
+            return elapsed / count;
+        };
+
+        quint64 cachedReads = 0;
+        quint64 managerReads = 0;
+        double cachedIdle = measure(true, &cachedReads);
+        double managerIdle = measure(false, &managerReads);
+
+        m_driver = std::thread([this]() {
+            Manager *manager = Manager::Get();
+            for (int i = 0; !m_stop; i++) {
+                manager->StubSetValue(m_valueIds.at(i % m_valueIds.count()), i);
+            }
+        });
+        quint64 ignored = 0;
+        double cachedBusy = measure(true, &ignored);
+        double managerBusy = measure(false, &ignored);
+        m_stop = true;
+        m_driver.join();
+        m_stop = false;
+
+        qCInfo(dcZwave()) << "ZwaveBenchmark:" << m_configuration.reads << "reads of" << values.count() << "values";
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Cached read" << QString::number(cachedIdle, 'f', 1) << "ns," << QString::number(cachedBusy, 'f', 1)
+                          << "ns while the driver updates values," << cachedReads << "Manager calls";
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Manager read" << QString::number(managerIdle, 'f', 1) << "ns," << QString::number(managerBusy, 'f', 1)
+                          << "ns while the driver updates values," << managerReads << "Manager calls";
+        return cachedReads == 0;
+    }
+
+    // Feeds a recorded trace through the watcher at the recorded pace times the speed factor.
+    // Every record is moved to the home ID of the benchmark interface, values are put into the
+    // stub Manager first so the plugin reads what the real network reported.
+    bool replay()
+    {
+        ZwaveTraceReader reader;
+        if (!reader.open(m_configuration.replay))
+            return false;
+
+        ZwaveManager *zwaveManager = m_plugin->findChild<ZwaveManager *>();
+        qint64 replayed = 0;
+        quint64 recordedDrops = 0;
+        qint64 recordedDuration = 0;
+        qint64 replayDuration = 0;
+        quint64 driverAllocations = 0;
+        m_driverDone = false;
+        quint64 allocations = t_allocations;
+        QElapsedTimer timer;
+        timer.start();
+
+        m_driver = std::thread([&]() {
+            Manager *manager = Manager::Get();
+            quint64 startAllocations = t_allocations;
+            QElapsedTimer clock;
+            clock.start();
+            manager->StubDriverReady(m_path.toStdString(), homeId);
+
+            qint64 first = -1;
+            ZwaveNotificationRecord record;
+            while (!m_stop && reader.read(&record)) {
+                if (first < 0)
+                    first = record.timestamp;
+
+                recordedDuration = record.timestamp - first;
+                if (m_configuration.speed > 0) {
+                    qint64 wait = static_cast<qint64>(recordedDuration / m_configuration.speed) - clock.nsecsElapsed();
+                    if (wait > 1000) {
+                        QThread::usleep(static_cast<unsigned long>(wait / 1000));
+                    }
+                }
+
+                // Drops while recording are counted, the driver of the benchmark is ready already
+                if (record.type == ZwaveNotificationRecord::TypeDropped) {
+                    recordedDrops += record.valueId;
+                    continue;
+                }
+                Notification::NotificationType type = static_cast<Notification::NotificationType>(record.type);
+                if (type == Notification::Type_DriverReady)
+                    continue;
+
+                // Node notifications carry a value ID with only the node ID set
+                ValueID valueId(homeId, record.valueId);
+                if (valueId.GetNodeId() != record.nodeId) {
+                    valueId = ValueID(homeId, record.nodeId);
+                }
+                if (type == Notification::Type_ValueAdded) {
+                    manager->StubAddValue(valueId, record.value.toVariant().toDouble());
+                } else if (type == Notification::Type_ValueChanged || type == Notification::Type_ValueRefreshed) {
+                    manager->StubSetValue(valueId, record.value.toVariant().toDouble());
+                }
+                manager->StubNotify(Notification(type, valueId, record.code));
+                replayed++;
+            }
+            replayDuration = clock.elapsed();
+            driverAllocations = t_allocations - startAllocations;
+            m_driverDone = true;
+        });
+
+        // Done once the driver thread is through the trace and the queue is drained
+        bool complete = waitFor([&]() {
+            return m_driverDone && (!zwaveManager || zwaveManager->notificationQueueDepth(homeId) == 0);
+        }, 24 * 60 * 60 * 1000);
+        qint64 elapsed = timer.elapsed();
+        allocations = t_allocations - allocations;
+        m_stop = true;
+        m_driver.join();
+        m_stop = false;
+
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Replayed" << replayed << "notifications of" << m_configuration.replay << "recorded over" << recordedDuration / 1000000 << "ms in"
+                          << replayDuration << "ms," << (replayDuration > 0 ? qRound64(replayed * 1000.0 / replayDuration) : 0) << "notifications/s,"
+                          << "processed in" << elapsed << "ms" << (complete ? "" : "(incomplete)");
+        qCInfo(dcZwave()) << "ZwaveBenchmark:" << recordedDrops << "notifications dropped while recording,"
+                          << (zwaveManager ? zwaveManager->droppedNotifications(homeId) : 0) << "dropped during the replay";
+        qCInfo(dcZwave()) << "ZwaveBenchmark: Allocations per notification" << QString::number(replayed > 0 ? static_cast<double>(allocations) / replayed : 0, 'f', 2)
+                          << "on the Qt thread," << QString::number(replayed > 0 ? static_cast<double>(driverAllocations) / replayed : 0, 'f', 2) << "on the driver thread";
+        return complete;
+    }
+
+    void teardown()
+    {
+        // Node things go first, the interface takes the manager with it
+        foreach (Thing *plug, m_plugs) {
+            m_plugin->thingRemoved(plug);
+            m_plugin->removeMyThing(plug);
+        }
+        if (m_interface) {
+            m_plugin->thingRemoved(m_interface);
+            m_plugin->removeMyThing(m_interface);
+        }
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+        delete m_plugin;
+        m_plugin = nullptr;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    application.setApplicationName("zwave-benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Notification and action benchmark of the nymea Z-Wave plugin on a virtual network");
+    parser.addHelpOption();
+    QCommandLineOption nodesOption("nodes", "Number of plugs, up to 231.", "count", "50");
+    QCommandLineOption valuesOption("values", "Values per node, at least 3.", "count", "20");
+    QCommandLineOption rateOption("rate", "Value notifications per second.", "rate", "1000");
+    QCommandLineOption durationOption("duration", "Duration of the notification storm in seconds.", "seconds", "10");
+    QCommandLineOption coalescingOption("coalescing", "Value change coalescing window in milliseconds.", "ms", "0");
+    QCommandLineOption scenesOption("scenes", "Number of scenes switching all plugs.", "count", "20");
+    QCommandLineOption readsOption("reads", "Rounds of reading all values, cached and through the Manager.", "count", "100");
+    QCommandLineOption replayOption("replay", "Replay a trace recorded with NYMEA_ZWAVE_TRACE instead of the virtual network.", "file");
+    QCommandLineOption speedOption("speed", "Replay speed, a factor of the recorded pace or max.", "factor", "1");
+    QCommandLineOption verboseOption("verbose", "Print the debug output of the plugin.");
+    parser.addOptions({nodesOption, valuesOption, rateOption, durationOption, coalescingOption, scenesOption, readsOption, replayOption, speedOption, verboseOption});
+    parser.process(application);
+
+    Configuration configuration;
+    configuration.nodes = qBound(1, parser.value(nodesOption).toInt(), 231);
+    configuration.values = qBound(3, parser.value(valuesOption).toInt(), 255);
+    configuration.rate = qMax(1, parser.value(rateOption).toInt());
+    configuration.duration = qMax(1, parser.value(durationOption).toInt());
+    configuration.coalescing = qMax(0, parser.value(coalescingOption).toInt());
+    configuration.scenes = qMax(0, parser.value(scenesOption).toInt());
+    configuration.reads = qMax(0, parser.value(readsOption).toInt());
+    configuration.replay = parser.value(replayOption);
+    if (parser.value(speedOption) == "max") {
+        configuration.speed = 0;
+    } else {
+        bool ok = false;
+        configuration.speed = parser.value(speedOption).toDouble(&ok);
+        if (!ok || configuration.speed <= 0) {
+            qWarning() << "Invalid replay speed" << parser.value(speedOption);
+            return 1;
+        }
+    }
+
+    QLoggingCategory::setFilterRules(parser.isSet(verboseOption) ? "Zwave.debug=true" : "Zwave.debug=false");
+
+    // A snapshot of an earlier run would be restored before the interview
+    QDir(NymeaSettings::settingsPath()).removeRecursively();
+
+    Benchmark benchmark(configuration);
+    return benchmark.run() ? 0 : 1;
+}
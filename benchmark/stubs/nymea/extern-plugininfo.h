@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef EXTERNPLUGININFO_H
+#define EXTERNPLUGININFO_H
+
+// Stand-in for the header nymea-plugininfocompiler generates from
+// integrationpluginzwave.json. Keep the IDs in sync with the JSON file.
+
+#include <QLoggingCategory>
+
+#include "integrations/thing.h"
+
+Q_DECLARE_LOGGING_CATEGORY(dcZwave)
+
+extern PluginId pluginId;
+extern ParamTypeId zwavePluginValueCoalescingWindowParamTypeId;
+extern ParamTypeId zwavePluginPollBudgetParamTypeId;
+extern VendorId zwaveVendorId;
+extern ThingClassId interfaceThingClassId;
+extern ParamTypeId interfaceThingPathParamTypeId;
+extern ParamTypeId interfaceThingSerialNumberParamTypeId;
+extern StateTypeId interfaceConnectedStateTypeId;
+extern StateTypeId interfaceHomeIdStateTypeId;
+extern StateTypeId interfaceManufacturerStateTypeId;
+extern StateTypeId interfaceProductNameStateTypeId;
+extern StateTypeId interfaceNotificationRateStateTypeId;
+extern StateTypeId interfaceDroppedNotificationsStateTypeId;
+extern StateTypeId interfaceCommandQueueDepthStateTypeId;
+extern StateTypeId interfaceActionLatencyStateTypeId;
+extern ActionTypeId interfaceSoftResetActionTypeId;
+extern ActionTypeId interfaceHardResetActionTypeId;
+extern ActionTypeId interfaceAddNodeActionTypeId;
+extern ActionTypeId interfaceDumpDiagnosticsActionTypeId;
+extern ThingClassId shutterThingClassId;
+extern ParamTypeId shutterThingIdParamTypeId;
+extern StateTypeId shutterConnectedStateTypeId;
+extern ActionTypeId shutterOpenActionTypeId;
+extern ActionTypeId shutterStopActionTypeId;
+extern ActionTypeId shutterCloseActionTypeId;
+extern ActionTypeId shutterRemoveNodeActionTypeId;
+extern ThingClassId plugThingClassId;
+extern ParamTypeId plugThingIdParamTypeId;
+extern StateTypeId plugConnectedStateTypeId;
+extern StateTypeId plugPowerStateTypeId;
+extern ActionTypeId plugPowerActionTypeId;
+extern ParamTypeId plugPowerActionPowerParamTypeId;
+extern StateTypeId plugCurrentPowerStateTypeId;
+extern StateTypeId plugTotalEnergyConsumedStateTypeId;
+extern StateTypeId plugAveragePowerOneMinuteStateTypeId;
+extern StateTypeId plugAveragePowerFifteenMinutesStateTypeId;
+extern StateTypeId plugMinimumPowerStateTypeId;
+extern StateTypeId plugMaximumPowerStateTypeId;
+extern ActionTypeId plugRemoveNodeActionTypeId;
+extern ThingClassId motionSensorThingClassId;
+extern ParamTypeId motionSensorThingIdParamTypeId;
+extern StateTypeId motionSensorConnectedStateTypeId;
+extern StateTypeId motionSensorIsPresentStateTypeId;
+extern StateTypeId motionSensorLastSeenTimeStateTypeId;
+extern ActionTypeId motionSensorRemoveNodeActionTypeId;
+
+#endif // EXTERNPLUGININFO_H
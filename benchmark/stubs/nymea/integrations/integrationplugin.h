@@ -0,0 +1,81 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INTEGRATIONPLUGIN_H
+#define INTEGRATIONPLUGIN_H
+
+#include "thing.h"
+#include "thingdescriptor.h"
+#include "thingactioninfo.h"
+#include "thingdiscoveryinfo.h"
+#include "thingsetupinfo.h"
+
+#include <QtPlugin>
+
+// The thing storage of the nymea core is replaced by addMyThing() and removeMyThing(),
+// which the benchmark calls where the core would set up or remove a thing.
+class IntegrationPlugin : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IntegrationPlugin(QObject *parent = nullptr) : QObject(parent) {}
+    virtual ~IntegrationPlugin() = default;
+
+    virtual void init() {}
+    virtual void startMonitoringAutoThings() {}
+    virtual void discoverThings(ThingDiscoveryInfo *info) { info->finish(Thing::ThingErrorUnsupportedFeature); }
+    virtual void setupThing(ThingSetupInfo *info) { info->finish(Thing::ThingErrorNoError); }
+    virtual void postSetupThing(Thing *thing) { Q_UNUSED(thing) }
+    virtual void thingRemoved(Thing *thing) { Q_UNUSED(thing) }
+    virtual void executeAction(ThingActionInfo *info) { info->finish(Thing::ThingErrorUnsupportedFeature); }
+
+    Things myThings() const { return m_things; }
+    void addMyThing(Thing *thing) { m_things.append(thing); }
+    void removeMyThing(Thing *thing) { m_things.removeAll(thing); }
+
+    QVariant configValue(const ParamTypeId &paramTypeId) const { return m_config.value(paramTypeId); }
+    void setConfigValue(const ParamTypeId &paramTypeId, const QVariant &value) {
+        m_config.insert(paramTypeId, value);
+        emit configValueChanged(paramTypeId, value);
+    }
+
+signals:
+    void configValueChanged(const ParamTypeId &paramTypeId, const QVariant &value);
+    void autoThingsAppeared(const ThingDescriptors &thingDescriptors);
+    void autoThingDisappeared(const ThingId &thingId);
+
+private:
+    Things m_things;
+    QHash<ParamTypeId, QVariant> m_config;
+};
+
+Q_DECLARE_INTERFACE(IntegrationPlugin, "io.nymea.IntegrationPlugin")
+
+#endif // INTEGRATIONPLUGIN_H
@@ -0,0 +1,194 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef THING_H
+#define THING_H
+
+// Minimal stand-in for the libnymea thing API, just enough to build and drive the
+// plugin without a nymea core. Things are created directly by the benchmark.
+
+#include <QObject>
+#include <QUuid>
+#include <QHash>
+#include <QList>
+#include <QVariant>
+
+#define STUB_DECLARE_TYPE_ID(type) \
+    class type##Id : public QUuid \
+    { \
+    public: \
+        type##Id(const QUuid &uuid = QUuid()) : QUuid(uuid) {} \
+        type##Id(const char *uuid) : QUuid(QString::fromLatin1(uuid)) {} \
+        static type##Id create##type##Id() { return type##Id(QUuid::createUuid()); } \
+    };
+
+STUB_DECLARE_TYPE_ID(Plugin)
+STUB_DECLARE_TYPE_ID(Vendor)
+STUB_DECLARE_TYPE_ID(ThingClass)
+STUB_DECLARE_TYPE_ID(Thing)
+STUB_DECLARE_TYPE_ID(ParamType)
+STUB_DECLARE_TYPE_ID(StateType)
+STUB_DECLARE_TYPE_ID(ActionType)
+
+class Param
+{
+public:
+    Param(const ParamTypeId &paramTypeId = ParamTypeId(), const QVariant &value = QVariant()) :
+        m_paramTypeId(paramTypeId), m_value(value) {}
+
+    ParamTypeId paramTypeId() const { return m_paramTypeId; }
+    QVariant value() const { return m_value; }
+    void setValue(const QVariant &value) { m_value = value; }
+
+private:
+    ParamTypeId m_paramTypeId;
+    QVariant m_value;
+};
+
+class ParamList : public QList<Param>
+{
+public:
+    Param param(const ParamTypeId &paramTypeId) const {
+        foreach (const Param &param, *this) {
+            if (param.paramTypeId() == paramTypeId) {
+                return param;
+            }
+        }
+        return Param();
+    }
+
+    QVariant paramValue(const ParamTypeId &paramTypeId) const { return param(paramTypeId).value(); }
+
+    void setParamValue(const ParamTypeId &paramTypeId, const QVariant &value) {
+        for (int i = 0; i < count(); i++) {
+            if (at(i).paramTypeId() == paramTypeId) {
+                (*this)[i].setValue(value);
+                return;
+            }
+        }
+        append(Param(paramTypeId, value));
+    }
+};
+
+class Thing : public QObject
+{
+    Q_OBJECT
+public:
+    enum ThingError {
+        ThingErrorNoError,
+        ThingErrorPluginNotFound,
+        ThingErrorVendorNotFound,
+        ThingErrorThingNotFound,
+        ThingErrorThingClassNotFound,
+        ThingErrorActionTypeNotFound,
+        ThingErrorStateTypeNotFound,
+        ThingErrorEventTypeNotFound,
+        ThingErrorThingDescriptorNotFound,
+        ThingErrorMissingParameter,
+        ThingErrorInvalidParameter,
+        ThingErrorSetupFailed,
+        ThingErrorDuplicateUuid,
+        ThingErrorCreationMethodNotSupported,
+        ThingErrorSetupMethodNotSupported,
+        ThingErrorHardwareNotAvailable,
+        ThingErrorHardwareFailure,
+        ThingErrorAuthenticationFailure,
+        ThingErrorThingInUse,
+        ThingErrorThingInRule,
+        ThingErrorThingIsChild,
+        ThingErrorPairingTransactionIdNotFound,
+        ThingErrorParameterNotWritable,
+        ThingErrorItemNotFound,
+        ThingErrorItemNotExecutable,
+        ThingErrorUnsupportedFeature,
+        ThingErrorTimeout
+    };
+    Q_ENUM(ThingError)
+
+    Thing(const ThingClassId &thingClassId, const QString &name, const ParamList &params, const ThingId &parentId = ThingId(), QObject *parent = nullptr) :
+        QObject(parent), m_id(ThingId::createThingId()), m_thingClassId(thingClassId), m_name(name), m_params(params), m_parentId(parentId) {}
+
+    ThingId id() const { return m_id; }
+    ThingClassId thingClassId() const { return m_thingClassId; }
+    QString name() const { return m_name; }
+    ThingId parentId() const { return m_parentId; }
+
+    ParamList params() const { return m_params; }
+    QVariant paramValue(const ParamTypeId &paramTypeId) const { return m_params.paramValue(paramTypeId); }
+    void setParamValue(const ParamTypeId &paramTypeId, const QVariant &value) { m_params.setParamValue(paramTypeId, value); }
+
+    QVariant stateValue(const StateTypeId &stateTypeId) const { return m_states.value(stateTypeId); }
+    void setStateValue(const StateTypeId &stateTypeId, const QVariant &value) {
+        QVariant &state = m_states[stateTypeId];
+        if (state == value)
+            return;
+        state = value;
+        emit stateValueChanged(stateTypeId, value);
+    }
+
+signals:
+    void stateValueChanged(const StateTypeId &stateTypeId, const QVariant &value);
+
+private:
+    ThingId m_id;
+    ThingClassId m_thingClassId;
+    QString m_name;
+    ParamList m_params;
+    ThingId m_parentId;
+    QHash<StateTypeId, QVariant> m_states;
+};
+
+class Things : public QList<Thing *>
+{
+public:
+    Things() = default;
+    Things(const QList<Thing *> &other) : QList<Thing *>(other) {}
+
+    Thing *findById(const ThingId &id) const {
+        foreach (Thing *thing, *this) {
+            if (thing->id() == id) {
+                return thing;
+            }
+        }
+        return nullptr;
+    }
+
+    Things filterByThingClassId(const ThingClassId &thingClassId) const {
+        Things things;
+        foreach (Thing *thing, *this) {
+            if (thing->thingClassId() == thingClassId) {
+                things.append(thing);
+            }
+        }
+        return things;
+    }
+};
+
+#endif // THING_H
@@ -0,0 +1,94 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef THINGACTIONINFO_H
+#define THINGACTIONINFO_H
+
+#include "thing.h"
+
+class Action
+{
+public:
+    enum TriggeredBy {
+        TriggeredByUser,
+        TriggeredByRule,
+        TriggeredByScript
+    };
+
+    Action(const ActionTypeId &actionTypeId = ActionTypeId(), const ThingId &thingId = ThingId(), const ParamList &params = ParamList(), TriggeredBy triggeredBy = TriggeredByUser) :
+        m_actionTypeId(actionTypeId), m_thingId(thingId), m_params(params), m_triggeredBy(triggeredBy) {}
+
+    ActionTypeId actionTypeId() const { return m_actionTypeId; }
+    ThingId thingId() const { return m_thingId; }
+    ParamList params() const { return m_params; }
+    Param param(const ParamTypeId &paramTypeId) const { return m_params.param(paramTypeId); }
+    TriggeredBy triggeredBy() const { return m_triggeredBy; }
+
+private:
+    ActionTypeId m_actionTypeId;
+    ThingId m_thingId;
+    ParamList m_params;
+    TriggeredBy m_triggeredBy = TriggeredByUser;
+};
+
+class ThingActionInfo : public QObject
+{
+    Q_OBJECT
+public:
+    ThingActionInfo(Thing *thing, const Action &action, QObject *parent = nullptr) :
+        QObject(parent), m_thing(thing), m_action(action) {}
+
+    Thing *thing() const { return m_thing; }
+    Action action() const { return m_action; }
+
+    bool isFinished() const { return m_finished; }
+    Thing::ThingError status() const { return m_status; }
+
+    void finish(Thing::ThingError status, const QString &displayMessage = QString()) {
+        Q_UNUSED(displayMessage)
+        if (m_finished)
+            return;
+        m_finished = true;
+        m_status = status;
+        emit finished();
+    }
+
+signals:
+    void finished();
+    void aborted();
+
+private:
+    Thing *m_thing = nullptr;
+    Action m_action;
+    bool m_finished = false;
+    Thing::ThingError m_status = Thing::ThingErrorNoError;
+};
+
+#endif // THINGACTIONINFO_H
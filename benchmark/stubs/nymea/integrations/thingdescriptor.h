@@ -0,0 +1,64 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef THINGDESCRIPTOR_H
+#define THINGDESCRIPTOR_H
+
+#include "thing.h"
+
+class ThingDescriptor
+{
+public:
+    ThingDescriptor(const ThingClassId &thingClassId = ThingClassId(), const QString &title = QString(), const QString &description = QString(), const ThingId &parentId = ThingId()) :
+        m_thingClassId(thingClassId), m_title(title), m_description(description), m_parentId(parentId) {}
+
+    ThingClassId thingClassId() const { return m_thingClassId; }
+    QString title() const { return m_title; }
+    QString description() const { return m_description; }
+    ThingId parentId() const { return m_parentId; }
+
+    ThingId thingId() const { return m_thingId; }
+    void setThingId(const ThingId &thingId) { m_thingId = thingId; }
+
+    ParamList params() const { return m_params; }
+    void setParams(const ParamList &params) { m_params = params; }
+
+private:
+    ThingClassId m_thingClassId;
+    QString m_title;
+    QString m_description;
+    ThingId m_parentId;
+    ThingId m_thingId;
+    ParamList m_params;
+};
+
+typedef QList<ThingDescriptor> ThingDescriptors;
+
+#endif // THINGDESCRIPTOR_H
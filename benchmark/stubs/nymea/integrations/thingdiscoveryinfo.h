@@ -0,0 +1,71 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef THINGDISCOVERYINFO_H
+#define THINGDISCOVERYINFO_H
+
+#include "thingdescriptor.h"
+
+class ThingDiscoveryInfo : public QObject
+{
+    Q_OBJECT
+public:
+    ThingDiscoveryInfo(const ThingClassId &thingClassId, QObject *parent = nullptr) :
+        QObject(parent), m_thingClassId(thingClassId) {}
+
+    ThingClassId thingClassId() const { return m_thingClassId; }
+
+    ThingDescriptors thingDescriptors() const { return m_thingDescriptors; }
+    void addThingDescriptor(const ThingDescriptor &thingDescriptor) { m_thingDescriptors.append(thingDescriptor); }
+
+    bool isFinished() const { return m_finished; }
+    Thing::ThingError status() const { return m_status; }
+
+    void finish(Thing::ThingError status, const QString &displayMessage = QString()) {
+        Q_UNUSED(displayMessage)
+        if (m_finished)
+            return;
+        m_finished = true;
+        m_status = status;
+        emit finished();
+    }
+
+signals:
+    void finished();
+    void aborted();
+
+private:
+    ThingClassId m_thingClassId;
+    ThingDescriptors m_thingDescriptors;
+    bool m_finished = false;
+    Thing::ThingError m_status = Thing::ThingErrorNoError;
+};
+
+#endif // THINGDISCOVERYINFO_H
@@ -0,0 +1,87 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef PLUGININFO_H
+#define PLUGININFO_H
+
+// Stand-in for the header nymea-plugininfocompiler generates from
+// integrationpluginzwave.json. Keep the IDs in sync with the JSON file.
+
+#include "extern-plugininfo.h"
+
+Q_LOGGING_CATEGORY(dcZwave, "Zwave")
+
+PluginId pluginId = PluginId("{71942c0e-a0d1-48a1-a22f-41052d9a85d1}");
+ParamTypeId zwavePluginValueCoalescingWindowParamTypeId = ParamTypeId("{a0fa0439-04f4-41ae-9738-cc963e23732f}");
+ParamTypeId zwavePluginPollBudgetParamTypeId = ParamTypeId("{7f05fed0-c8b9-44ba-9ea5-0038bab1c8c5}");
+VendorId zwaveVendorId = VendorId("{ba199bbf-7e94-4daf-ab01-76ca3f2d5eff}");
+ThingClassId interfaceThingClassId = ThingClassId("{b2609e06-e650-41bb-ba67-a2c0fad9fb85}");
+ParamTypeId interfaceThingPathParamTypeId = ParamTypeId("{90bc9422-e527-469a-981e-74f56839910b}");
+ParamTypeId interfaceThingSerialNumberParamTypeId = ParamTypeId("{fc35e72b-179a-4a2f-ac9f-c4715c0baee1}");
+StateTypeId interfaceConnectedStateTypeId = StateTypeId("{c9b13693-fd4a-4ec6-ad3c-f675fc62689e}");
+StateTypeId interfaceHomeIdStateTypeId = StateTypeId("{9a349cd3-35e1-4d5e-bef1-bd3abde8a956}");
+StateTypeId interfaceManufacturerStateTypeId = StateTypeId("{7c0640b1-0ea7-4008-8617-b352e2db68a81}");
+StateTypeId interfaceProductNameStateTypeId = StateTypeId("{20903898-7be7-4a43-9838-d04b1f761c65}");
+StateTypeId interfaceNotificationRateStateTypeId = StateTypeId("{9337d0bb-fdc3-436b-9bb5-0699635a779b}");
+StateTypeId interfaceDroppedNotificationsStateTypeId = StateTypeId("{0f7b370f-79f8-47b8-b1ea-f2bd5a0df79b}");
+StateTypeId interfaceCommandQueueDepthStateTypeId = StateTypeId("{72398224-d31d-41b2-bca6-c45d0b427152}");
+StateTypeId interfaceActionLatencyStateTypeId = StateTypeId("{75bbdf43-939e-42e1-80da-024f78ca782c}");
+ActionTypeId interfaceSoftResetActionTypeId = ActionTypeId("{28be4e4d-f4c3-4b31-97ee-9ce72693027c}");
+ActionTypeId interfaceHardResetActionTypeId = ActionTypeId("{f12deccf-a220-4a29-b00e-06c5f7fcb179}");
+ActionTypeId interfaceAddNodeActionTypeId = ActionTypeId("{9618fe8c-a8cc-481f-bbcf-3061ea9f6c1d}");
+ActionTypeId interfaceDumpDiagnosticsActionTypeId = ActionTypeId("{6e7f2c4a-4a0b-4c7e-9d5e-1f0f7b3e2a61}");
+ThingClassId shutterThingClassId = ThingClassId("{281ab0f2-277a-42c4-a843-53f55c137e25}");
+ParamTypeId shutterThingIdParamTypeId = ParamTypeId("{71140a14-1cbe-413b-80d3-46a5407804f5}");
+StateTypeId shutterConnectedStateTypeId = StateTypeId("{53e175d0-0107-4890-8561-b4250b9d2c09}");
+ActionTypeId shutterOpenActionTypeId = ActionTypeId("{7bf56a31-dc92-48fe-bea1-208a91e71764}");
+ActionTypeId shutterStopActionTypeId = ActionTypeId("{e87fafdb-e324-4cc8-b0ca-215802ce7c49}");
+ActionTypeId shutterCloseActionTypeId = ActionTypeId("{e76b1b5a-dd9c-4bce-a848-3d9b086a3c1a}");
+ActionTypeId shutterRemoveNodeActionTypeId = ActionTypeId("{95d274cf-c584-4dec-83bd-86715d3299a3}");
+ThingClassId plugThingClassId = ThingClassId("{69f2a895-dc54-4e42-bb74-c2e95361c57e}");
+ParamTypeId plugThingIdParamTypeId = ParamTypeId("{1e6b42d5-74b5-4888-981c-5952c8347fba}");
+StateTypeId plugConnectedStateTypeId = StateTypeId("{17190892-d5d0-428e-b3b6-ef0cab94656f}");
+StateTypeId plugPowerStateTypeId = StateTypeId("{4ddf7a02-4ccd-4ab6-9a78-d932e686cfa4}");
+ActionTypeId plugPowerActionTypeId = ActionTypeId("{4ddf7a02-4ccd-4ab6-9a78-d932e686cfa4}");
+ParamTypeId plugPowerActionPowerParamTypeId = ParamTypeId("{4ddf7a02-4ccd-4ab6-9a78-d932e686cfa4}");
+StateTypeId plugCurrentPowerStateTypeId = StateTypeId("{5b473314-3b40-42df-a4f8-3e5312d05653}");
+StateTypeId plugTotalEnergyConsumedStateTypeId = StateTypeId("{65a342be-d8c0-4f2d-b868-ee739034ea71}");
+StateTypeId plugAveragePowerOneMinuteStateTypeId = StateTypeId("{9c93e936-610c-44b7-8d91-532c65362127}");
+StateTypeId plugAveragePowerFifteenMinutesStateTypeId = StateTypeId("{5c96df0a-d089-496f-906f-840027f6f02c}");
+StateTypeId plugMinimumPowerStateTypeId = StateTypeId("{fb54c9eb-ff06-4271-9a96-5455bd8e09e4}");
+StateTypeId plugMaximumPowerStateTypeId = StateTypeId("{c7a9f6c5-90cb-4c37-a116-2ae81a8dd7d9}");
+ActionTypeId plugRemoveNodeActionTypeId = ActionTypeId("{6df95b3e-9ecc-41f4-8ad9-2318c9ee1a97}");
+ThingClassId motionSensorThingClassId = ThingClassId("{c6672fbc-46ce-446b-9fa4-7c66a01b4845}");
+ParamTypeId motionSensorThingIdParamTypeId = ParamTypeId("{be3949e6-2c32-4762-90dc-e421ce0a355f}");
+StateTypeId motionSensorConnectedStateTypeId = StateTypeId("{86607b06-4fe9-45b2-a495-5ed78eed3ead}");
+StateTypeId motionSensorIsPresentStateTypeId = StateTypeId("{001f2e90-8cb0-4a26-82b1-8df3d1daecc9}");
+StateTypeId motionSensorLastSeenTimeStateTypeId = StateTypeId("{244fe4fc-b96b-4a6c-9748-7f7c7ea5ca03}");
+ActionTypeId motionSensorRemoveNodeActionTypeId = ActionTypeId("{9b665bba-aa3f-44e3-b839-7964d6b8dec7}");
+
+#endif // PLUGININFO_H
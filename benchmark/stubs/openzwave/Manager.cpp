@@ -0,0 +1,476 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "Manager.h"
+#include "Options.h"
+
+#include <algorithm>
+
+using namespace OpenZWave;
+
+static Manager *s_manager = nullptr;
+static Options *s_options = nullptr;
+
+Options *Options::Create(const std::string &configPath, const std::string &userPath, const std::string &commandLine)
+{
+    (void)configPath;
+    (void)userPath;
+    (void)commandLine;
+    if (!s_options) {
+        s_options = new Options();
+    }
+    return s_options;
+}
+
+bool Options::Destroy()
+{
+    delete s_options;
+    s_options = nullptr;
+    return true;
+}
+
+Options *Options::Get()
+{
+    return s_options;
+}
+
+bool Options::Lock()
+{
+    m_locked = true;
+    return true;
+}
+
+bool Options::AreLocked() const
+{
+    return m_locked;
+}
+
+bool Options::AddOptionBool(const std::string &name, bool value)
+{
+    (void)name;
+    (void)value;
+    return !m_locked;
+}
+
+bool Options::AddOptionInt(const std::string &name, int32 value)
+{
+    (void)name;
+    (void)value;
+    return !m_locked;
+}
+
+bool Options::AddOptionString(const std::string &name, const std::string &value, bool append)
+{
+    (void)name;
+    (void)value;
+    (void)append;
+    return !m_locked;
+}
+
+Manager *Manager::Create()
+{
+    if (!s_manager) {
+        s_manager = new Manager();
+    }
+    return s_manager;
+}
+
+Manager *Manager::Get()
+{
+    return s_manager;
+}
+
+void Manager::Destroy()
+{
+    delete s_manager;
+    s_manager = nullptr;
+}
+
+std::string Manager::getVersionAsString()
+{
+    return "stub";
+}
+
+bool Manager::AddWatcher(pfnOnNotification_t watcher, void *context)
+{
+    std::lock_guard<std::mutex> locker(m_notificationMutex);
+    m_watchers.push_back(std::make_pair(watcher, context));
+    return true;
+}
+
+bool Manager::RemoveWatcher(pfnOnNotification_t watcher, void *context)
+{
+    std::lock_guard<std::mutex> locker(m_notificationMutex);
+    auto it = std::find(m_watchers.begin(), m_watchers.end(), std::make_pair(watcher, context));
+    if (it == m_watchers.end())
+        return false;
+
+    m_watchers.erase(it);
+    return true;
+}
+
+bool Manager::AddDriver(const std::string &controllerPath, const Driver::ControllerInterface &interface)
+{
+    (void)interface;
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (std::find(m_drivers.begin(), m_drivers.end(), controllerPath) != m_drivers.end())
+        return false;
+
+    m_drivers.push_back(controllerPath);
+    return true;
+}
+
+bool Manager::RemoveDriver(const std::string &controllerPath)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = std::find(m_drivers.begin(), m_drivers.end(), controllerPath);
+    if (it == m_drivers.end())
+        return false;
+
+    m_drivers.erase(it);
+    return true;
+}
+
+uint8 Manager::GetControllerNodeId(uint32 homeId)
+{
+    (void)homeId;
+    return 1;
+}
+
+std::string Manager::GetControllerPath(uint32 homeId)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = m_controllerPaths.find(homeId);
+    return it == m_controllerPaths.end() ? std::string() : it->second;
+}
+
+int32 Manager::GetSendQueueCount(uint32 homeId)
+{
+    (void)homeId;
+    return 0;
+}
+
+void Manager::ResetController(uint32 homeId)
+{
+    (void)homeId;
+}
+
+void Manager::SoftReset(uint32 homeId)
+{
+    (void)homeId;
+}
+
+bool Manager::AddNode(uint32 homeId, bool doSecurity)
+{
+    (void)homeId;
+    (void)doSecurity;
+    return false;
+}
+
+bool Manager::RemoveNode(uint32 homeId)
+{
+    (void)homeId;
+    return false;
+}
+
+#define STUB_NODE_GETTER(type, name, member, fallback) \
+    type Manager::name(uint32 homeId, uint8 nodeId) \
+    { \
+        std::lock_guard<std::mutex> locker(m_mutex); \
+        auto it = m_nodes.find(std::make_pair(homeId, nodeId)); \
+        return it == m_nodes.end() ? fallback : it->second.member; \
+    }
+
+STUB_NODE_GETTER(std::string, GetNodeName, name, std::string())
+STUB_NODE_GETTER(std::string, GetNodeManufacturerName, manufacturerName, std::string())
+STUB_NODE_GETTER(std::string, GetNodeManufacturerId, manufacturerId, std::string())
+STUB_NODE_GETTER(std::string, GetNodeProductType, productType, std::string())
+STUB_NODE_GETTER(std::string, GetNodeProductId, productId, std::string())
+STUB_NODE_GETTER(std::string, GetNodeProductName, productName, std::string())
+STUB_NODE_GETTER(uint8, GetNodeGeneric, generic, 0)
+STUB_NODE_GETTER(uint8, GetNodeSpecific, specific, 0)
+STUB_NODE_GETTER(bool, IsNodeListeningDevice, listening, false)
+
+std::string Manager::GetNodeDeviceTypeString(uint32 homeId, uint8 nodeId)
+{
+    (void)homeId;
+    (void)nodeId;
+    return std::string();
+}
+
+uint16 Manager::GetNodeDeviceType(uint32 homeId, uint8 nodeId)
+{
+    (void)homeId;
+    (void)nodeId;
+    return 0;
+}
+
+bool Manager::IsNodeFrequentListeningDevice(uint32 homeId, uint8 nodeId)
+{
+    (void)homeId;
+    (void)nodeId;
+    return false;
+}
+
+bool Manager::IsNodeAwake(uint32 homeId, uint8 nodeId)
+{
+    return IsNodeListeningDevice(homeId, nodeId);
+}
+
+bool Manager::IsNodeFailed(uint32 homeId, uint8 nodeId)
+{
+    (void)homeId;
+    (void)nodeId;
+    return false;
+}
+
+uint32 Manager::GetNodeNeighbors(uint32 homeId, uint8 nodeId, uint8 **neighbors)
+{
+    (void)homeId;
+    (void)nodeId;
+    *neighbors = nullptr;
+    return 0;
+}
+
+void Manager::GetNodeStatistics(uint32 homeId, uint8 nodeId, Node::NodeData *data)
+{
+    (void)homeId;
+    (void)nodeId;
+    *data = Node::NodeData();
+}
+
+void Manager::HealNetworkNode(uint32 homeId, uint8 nodeId, bool doReturnRoutes)
+{
+    (void)homeId;
+    (void)nodeId;
+    (void)doReturnRoutes;
+}
+
+void Manager::TestNetworkNode(uint32 homeId, uint8 nodeId, uint32 count)
+{
+    (void)count;
+    StubNotify(Notification(Notification::Type_Notification, ValueID(homeId, nodeId), Notification::Code_NoOperation));
+}
+
+std::string Manager::GetValueLabel(const ValueID &valueId, int32 pos)
+{
+    (void)pos;
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = m_values.find(std::make_pair(valueId.GetHomeId(), valueId.GetId()));
+    return it == m_values.end() ? std::string() : it->second.label;
+}
+
+std::string Manager::GetValueHelp(const ValueID &valueId, int32 pos)
+{
+    (void)valueId;
+    (void)pos;
+    return std::string();
+}
+
+std::string Manager::GetValueUnits(const ValueID &valueId)
+{
+    return valueId.GetCommandClassId() == 0x32 ? (valueId.GetIndex() == 0 ? "kWh" : "W") : std::string();
+}
+
+int32 Manager::GetValueMin(const ValueID &valueId)
+{
+    (void)valueId;
+    return 0;
+}
+
+int32 Manager::GetValueMax(const ValueID &valueId)
+{
+    (void)valueId;
+    return 0;
+}
+
+bool Manager::readValue(const ValueID &valueId, double *value)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_valueReads++;
+    auto it = m_values.find(std::make_pair(valueId.GetHomeId(), valueId.GetId()));
+    if (it == m_values.end())
+        return false;
+
+    *value = it->second.value;
+    return true;
+}
+
+bool Manager::GetValueAsBool(const ValueID &valueId, bool *value)
+{
+    double raw = 0;
+    if (!readValue(valueId, &raw))
+        return false;
+
+    *value = raw != 0;
+    return true;
+}
+
+bool Manager::GetValueAsByte(const ValueID &valueId, uint8 *value)
+{
+    double raw = 0;
+    if (!readValue(valueId, &raw))
+        return false;
+
+    *value = static_cast<uint8>(raw);
+    return true;
+}
+
+bool Manager::GetValueAsFloat(const ValueID &valueId, float *value)
+{
+    double raw = 0;
+    if (!readValue(valueId, &raw))
+        return false;
+
+    *value = static_cast<float>(raw);
+    return true;
+}
+
+bool Manager::GetValueAsInt(const ValueID &valueId, int32 *value)
+{
+    double raw = 0;
+    if (!readValue(valueId, &raw))
+        return false;
+
+    *value = static_cast<int32>(raw);
+    return true;
+}
+
+bool Manager::GetValueAsShort(const ValueID &valueId, int16 *value)
+{
+    double raw = 0;
+    if (!readValue(valueId, &raw))
+        return false;
+
+    *value = static_cast<int16>(raw);
+    return true;
+}
+
+bool Manager::GetValueListSelection(const ValueID &valueId, int32 *value)
+{
+    return GetValueAsInt(valueId, value);
+}
+
+void Manager::setAndReport(const ValueID &valueId, double value)
+{
+    StubSetValue(valueId, value);
+    StubNotify(Notification(Notification::Type_ValueChanged, valueId));
+}
+
+bool Manager::SetValue(const ValueID &valueId, bool value)
+{
+    setAndReport(valueId, value ? 1 : 0);
+    return true;
+}
+
+bool Manager::SetValue(const ValueID &valueId, uint8 value)
+{
+    setAndReport(valueId, value);
+    return true;
+}
+
+bool Manager::SetValue(const ValueID &valueId, float value)
+{
+    setAndReport(valueId, value);
+    return true;
+}
+
+bool Manager::SetValue(const ValueID &valueId, int32 value)
+{
+    setAndReport(valueId, value);
+    return true;
+}
+
+bool Manager::SetValue(const ValueID &valueId, int16 value)
+{
+    setAndReport(valueId, value);
+    return true;
+}
+
+bool Manager::RefreshValue(const ValueID &valueId)
+{
+    StubNotify(Notification(Notification::Type_ValueRefreshed, valueId));
+    return true;
+}
+
+bool Manager::PressButton(const ValueID &valueId)
+{
+    (void)valueId;
+    return true;
+}
+
+bool Manager::ReleaseButton(const ValueID &valueId)
+{
+    (void)valueId;
+    return true;
+}
+
+void Manager::StubDriverReady(const std::string &controllerPath, uint32 homeId)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_controllerPaths[homeId] = controllerPath;
+    }
+    StubNotify(Notification(Notification::Type_DriverReady, ValueID(homeId, GetControllerNodeId(homeId))));
+}
+
+void Manager::StubAddNode(uint32 homeId, uint8 nodeId, const StubNode &node)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nodes[std::make_pair(homeId, nodeId)] = node;
+}
+
+void Manager::StubAddValue(const ValueID &valueId, double value, const std::string &label)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    Value &entry = m_values[std::make_pair(valueId.GetHomeId(), valueId.GetId())];
+    entry.value = value;
+    entry.label = label;
+}
+
+void Manager::StubSetValue(const ValueID &valueId, double value)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_values[std::make_pair(valueId.GetHomeId(), valueId.GetId())].value = value;
+}
+
+void Manager::StubNotify(const Notification &notification)
+{
+    std::lock_guard<std::mutex> locker(m_notificationMutex);
+    for (const auto &watcher : m_watchers) {
+        watcher.first(&notification, watcher.second);
+    }
+}
+
+uint64 Manager::StubValueReads() const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_valueReads;
+}
@@ -0,0 +1,157 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef STUB_OPENZWAVE_MANAGER_H
+#define STUB_OPENZWAVE_MANAGER_H
+
+#include "Defs.h"
+#include "Driver.h"
+#include "Node.h"
+#include "Notification.h"
+#include "value_classes/ValueID.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace OpenZWave {
+
+class Manager
+{
+public:
+    typedef void (*pfnOnNotification_t)(const Notification *notification, void *context);
+
+    // Node description for StubAddNode()
+    struct StubNode {
+        std::string name;
+        std::string manufacturerName;
+        std::string manufacturerId = "0x0000";
+        std::string productType = "0x0000";
+        std::string productId = "0x0000";
+        std::string productName;
+        uint8 generic = 0;
+        uint8 specific = 0;
+        bool listening = true;
+    };
+
+    static Manager *Create();
+    static Manager *Get();
+    static void Destroy();
+    static std::string getVersionAsString();
+
+    bool AddWatcher(pfnOnNotification_t watcher, void *context);
+    bool RemoveWatcher(pfnOnNotification_t watcher, void *context);
+
+    bool AddDriver(const std::string &controllerPath, const Driver::ControllerInterface &interface = Driver::ControllerInterface_Serial);
+    bool RemoveDriver(const std::string &controllerPath);
+    uint8 GetControllerNodeId(uint32 homeId);
+    std::string GetControllerPath(uint32 homeId);
+    int32 GetSendQueueCount(uint32 homeId);
+    void ResetController(uint32 homeId);
+    void SoftReset(uint32 homeId);
+    bool AddNode(uint32 homeId, bool doSecurity = true);
+    bool RemoveNode(uint32 homeId);
+
+    std::string GetNodeName(uint32 homeId, uint8 nodeId);
+    std::string GetNodeManufacturerName(uint32 homeId, uint8 nodeId);
+    std::string GetNodeManufacturerId(uint32 homeId, uint8 nodeId);
+    std::string GetNodeProductType(uint32 homeId, uint8 nodeId);
+    std::string GetNodeProductId(uint32 homeId, uint8 nodeId);
+    std::string GetNodeProductName(uint32 homeId, uint8 nodeId);
+    std::string GetNodeDeviceTypeString(uint32 homeId, uint8 nodeId);
+    uint16 GetNodeDeviceType(uint32 homeId, uint8 nodeId);
+    uint8 GetNodeGeneric(uint32 homeId, uint8 nodeId);
+    uint8 GetNodeSpecific(uint32 homeId, uint8 nodeId);
+    bool IsNodeListeningDevice(uint32 homeId, uint8 nodeId);
+    bool IsNodeFrequentListeningDevice(uint32 homeId, uint8 nodeId);
+    bool IsNodeAwake(uint32 homeId, uint8 nodeId);
+    bool IsNodeFailed(uint32 homeId, uint8 nodeId);
+    uint32 GetNodeNeighbors(uint32 homeId, uint8 nodeId, uint8 **neighbors);
+    void GetNodeStatistics(uint32 homeId, uint8 nodeId, Node::NodeData *data);
+    void HealNetworkNode(uint32 homeId, uint8 nodeId, bool doReturnRoutes);
+    void TestNetworkNode(uint32 homeId, uint8 nodeId, uint32 count = 1);
+
+    std::string GetValueLabel(const ValueID &valueId, int32 pos = -1);
+    std::string GetValueHelp(const ValueID &valueId, int32 pos = -1);
+    std::string GetValueUnits(const ValueID &valueId);
+    int32 GetValueMin(const ValueID &valueId);
+    int32 GetValueMax(const ValueID &valueId);
+
+    bool GetValueAsBool(const ValueID &valueId, bool *value);
+    bool GetValueAsByte(const ValueID &valueId, uint8 *value);
+    bool GetValueAsFloat(const ValueID &valueId, float *value);
+    bool GetValueAsInt(const ValueID &valueId, int32 *value);
+    bool GetValueAsShort(const ValueID &valueId, int16 *value);
+    bool GetValueListSelection(const ValueID &valueId, int32 *value);
+
+    // A set value is reported back right away, like a device confirming the change
+    bool SetValue(const ValueID &valueId, bool value);
+    bool SetValue(const ValueID &valueId, uint8 value);
+    bool SetValue(const ValueID &valueId, float value);
+    bool SetValue(const ValueID &valueId, int32 value);
+    bool SetValue(const ValueID &valueId, int16 value);
+    bool RefreshValue(const ValueID &valueId);
+    bool PressButton(const ValueID &valueId);
+    bool ReleaseButton(const ValueID &valueId);
+
+    // Not part of OpenZWave, the benchmark builds its network and drives the watchers with these
+    void StubDriverReady(const std::string &controllerPath, uint32 homeId);
+    void StubAddNode(uint32 homeId, uint8 nodeId, const StubNode &node);
+    void StubAddValue(const ValueID &valueId, double value, const std::string &label = std::string());
+    void StubSetValue(const ValueID &valueId, double value);
+    void StubNotify(const Notification &notification);
+    uint64 StubValueReads() const;
+
+private:
+    Manager() = default;
+
+    struct Value {
+        double value = 0;
+        std::string label;
+    };
+
+    void setAndReport(const ValueID &valueId, double value);
+    bool readValue(const ValueID &valueId, double *value);
+
+    // Watchers are called one at a time, OpenZWave holds its notification mutex for that
+    std::mutex m_notificationMutex;
+    std::vector<std::pair<pfnOnNotification_t, void *>> m_watchers;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_drivers;
+    std::map<uint32, std::string> m_controllerPaths;
+    std::map<std::pair<uint32, uint8>, StubNode> m_nodes;
+    std::map<std::pair<uint32, uint64>, Value> m_values;
+    uint64 m_valueReads = 0;
+};
+
+}
+
+#endif // STUB_OPENZWAVE_MANAGER_H
@@ -0,0 +1,107 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef STUB_OPENZWAVE_NOTIFICATION_H
+#define STUB_OPENZWAVE_NOTIFICATION_H
+
+#include "Defs.h"
+#include "value_classes/ValueID.h"
+
+namespace OpenZWave {
+
+class Notification
+{
+public:
+    enum NotificationType {
+        Type_ValueAdded = 0,
+        Type_ValueRemoved,
+        Type_ValueChanged,
+        Type_ValueRefreshed,
+        Type_Group,
+        Type_NodeNew,
+        Type_NodeAdded,
+        Type_NodeRemoved,
+        Type_NodeProtocolInfo,
+        Type_NodeNaming,
+        Type_NodeEvent,
+        Type_PollingDisabled,
+        Type_PollingEnabled,
+        Type_SceneEvent,
+        Type_CreateButton,
+        Type_DeleteButton,
+        Type_ButtonOn,
+        Type_ButtonOff,
+        Type_DriverReady,
+        Type_DriverFailed,
+        Type_DriverReset,
+        Type_EssentialNodeQueriesComplete,
+        Type_NodeQueriesComplete,
+        Type_AwakeNodesQueried,
+        Type_AllNodesQueriedSomeDead,
+        Type_AllNodesQueried,
+        Type_Notification,
+        Type_DriverRemoved,
+        Type_ControllerCommand,
+        Type_NodeReset,
+        Type_UserAlerts,
+        Type_ManufacturerSpecificDBReady
+    };
+
+    enum NotificationCode {
+        Code_MsgComplete = 0,
+        Code_Timeout,
+        Code_NoOperation,
+        Code_Awake,
+        Code_Sleep,
+        Code_Dead,
+        Code_Alive
+    };
+
+    // OpenZWave creates notifications in the driver, the benchmark creates them itself
+    Notification(NotificationType type, const ValueID &valueId, uint8 byte = 0) :
+        m_type(type), m_valueId(valueId), m_byte(byte) {}
+
+    NotificationType GetType() const { return m_type; }
+    uint32 GetHomeId() const { return m_valueId.GetHomeId(); }
+    uint8 GetNodeId() const { return m_valueId.GetNodeId(); }
+    const ValueID &GetValueID() const { return m_valueId; }
+    uint8 GetByte() const { return m_byte; }
+    uint8 GetEvent() const { return m_byte; }
+    uint8 GetNotification() const { return m_byte; }
+
+private:
+    NotificationType m_type;
+    ValueID m_valueId;
+    uint8 m_byte = 0;
+};
+
+}
+
+#endif // STUB_OPENZWAVE_NOTIFICATION_H
@@ -0,0 +1,102 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef STUB_OPENZWAVE_VALUEID_H
+#define STUB_OPENZWAVE_VALUEID_H
+
+#include "../Defs.h"
+
+namespace OpenZWave {
+
+// Same packing as OpenZWave: node ID in bits 24-31, genre 22-23, command class 14-21,
+// index 4-11 and type 0-3 of the low word, the instance in bits 24-31 of the high word.
+class ValueID
+{
+public:
+    enum ValueGenre {
+        ValueGenre_Basic = 0,
+        ValueGenre_User,
+        ValueGenre_Config,
+        ValueGenre_System,
+        ValueGenre_Count
+    };
+
+    enum ValueType {
+        ValueType_Bool = 0,
+        ValueType_Byte,
+        ValueType_Decimal,
+        ValueType_Int,
+        ValueType_List,
+        ValueType_Schedule,
+        ValueType_Short,
+        ValueType_String,
+        ValueType_Button,
+        ValueType_Raw,
+        ValueType_BitSet,
+        ValueType_Max = ValueType_BitSet
+    };
+
+    ValueID(uint32 homeId, uint8 nodeId, ValueGenre genre, uint8 commandClassId, uint8 instance, uint16 valueIndex, ValueType type) :
+        m_homeId(homeId),
+        m_id((static_cast<uint32>(nodeId) << 24) | (static_cast<uint32>(genre) << 22) | (static_cast<uint32>(commandClassId) << 14)
+             | ((static_cast<uint32>(valueIndex) & 0xff) << 4) | static_cast<uint32>(type)),
+        m_id1(static_cast<uint32>(instance) << 24) {}
+    ValueID(uint32 homeId, uint64 id) :
+        m_homeId(homeId), m_id(static_cast<uint32>(id & 0xffffffff)), m_id1(static_cast<uint32>(id >> 32)) {}
+    ValueID(uint32 homeId, uint8 nodeId) :
+        m_homeId(homeId), m_id(static_cast<uint32>(nodeId) << 24), m_id1(0) {}
+    ValueID() = default;
+
+    uint32 GetHomeId() const { return m_homeId; }
+    uint8 GetNodeId() const { return static_cast<uint8>((m_id & 0xff000000) >> 24); }
+    ValueGenre GetGenre() const { return static_cast<ValueGenre>((m_id & 0x00c00000) >> 22); }
+    uint8 GetCommandClassId() const { return static_cast<uint8>((m_id & 0x003fc000) >> 14); }
+    uint8 GetInstance() const { return static_cast<uint8>((m_id1 & 0xff000000) >> 24); }
+    uint16 GetIndex() const { return static_cast<uint16>((m_id & 0x00000ff0) >> 4); }
+    ValueType GetType() const { return static_cast<ValueType>(m_id & 0x0000000f); }
+    uint64 GetId() const { return (static_cast<uint64>(m_id1) << 32) | m_id; }
+
+    bool operator==(const ValueID &other) const { return m_homeId == other.m_homeId && m_id == other.m_id && m_id1 == other.m_id1; }
+    bool operator!=(const ValueID &other) const { return !(*this == other); }
+    bool operator<(const ValueID &other) const {
+        if (m_homeId != other.m_homeId)
+            return m_homeId < other.m_homeId;
+        return GetId() < other.GetId();
+    }
+
+private:
+    uint32 m_homeId = 0;
+    uint32 m_id = 0;
+    uint32 m_id1 = 0;
+};
+
+}
+
+#endif // STUB_OPENZWAVE_VALUEID_H
@@ -31,7 +31,6 @@
 #include "integrationpluginzwave.h"
 #include "plugininfo.h"
 
-#include <QSerialPortInfo>
 
 using namespace OpenZWave;
 
@@ -44,35 +43,119 @@ IntegrationPluginZwave::IntegrationPluginZwave()
     m_connectedStateTypeIds.insert(interfaceThingClassId, interfaceConnectedStateTypeId);
     m_connectedStateTypeIds.insert(plugThingClassId, plugConnectedStateTypeId);
     m_connectedStateTypeIds.insert(shutterThingClassId, shutterConnectedStateTypeId);
-    m_connectedStateTypeIds.insert(motionSensorThingClassId, motionSensorThingClassId);
+    m_connectedStateTypeIds.insert(motionSensorThingClassId, motionSensorConnectedStateTypeId);
 
     m_removeNodeActionTypeIds.insert(plugThingClassId, plugRemoveNodeActionTypeId);
     m_removeNodeActionTypeIds.insert(shutterThingClassId, shutterRemoveNodeActionTypeId);
     m_removeNodeActionTypeIds.insert(motionSensorThingClassId, motionSensorRemoveNodeActionTypeId);
+
+    m_deviceClassThingClassIds.insert(ZwaveDeviceClass::KindShutter, shutterThingClassId);
+    m_deviceClassThingClassIds.insert(ZwaveDeviceClass::KindPlug, plugThingClassId);
+    m_deviceClassThingClassIds.insert(ZwaveDeviceClass::KindMotionSensor, motionSensorThingClassId);
+
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleSwitchBinary, plugPowerStateTypeId, ZwaveStateBindings::ConversionBool});
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleMeterPower, plugCurrentPowerStateTypeId, ZwaveStateBindings::ConversionDouble});
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleMeterPower, plugAveragePowerOneMinuteStateTypeId, ZwaveStateBindings::ConversionAverageShort});
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleMeterPower, plugAveragePowerFifteenMinutesStateTypeId, ZwaveStateBindings::ConversionAverageLong});
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleMeterPower, plugMinimumPowerStateTypeId, ZwaveStateBindings::ConversionMinimumLong});
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleMeterPower, plugMaximumPowerStateTypeId, ZwaveStateBindings::ConversionMaximumLong});
+    m_stateBindingTypes[plugThingClassId].append({ZwaveNode::ValueRoleMeterEnergy, plugTotalEnergyConsumedStateTypeId, ZwaveStateBindings::ConversionDouble});
+    m_stateBindingTypes[motionSensorThingClassId].append({ZwaveNode::ValueRoleSensorBinary, motionSensorIsPresentStateTypeId, ZwaveStateBindings::ConversionBool});
+    m_stateBindingTypes[motionSensorThingClassId].append({ZwaveNode::ValueRoleSensorBinary, motionSensorLastSeenTimeStateTypeId, ZwaveStateBindings::ConversionLastSeen});
+
+    // Virtual controller on a pseudo terminal, discovered like a real stick
+    if (qEnvironmentVariableIsSet("NYMEA_ZWAVE_SIMULATOR")) {
+        m_simulator = new ZwaveSimulator(ZwaveSimulator::parseConfiguration(QString::fromUtf8(qgetenv("NYMEA_ZWAVE_SIMULATOR"))), this);
+        if (!m_simulator->start()) {
+            delete m_simulator;
+            m_simulator = nullptr;
+        }
+    }
+
+    // Serial ports are enumerated once, udev tells us about sticks plugged in or out later
+    m_serialPortIndex = new ZwaveSerialPortIndex(this);
+    connect(m_serialPortIndex, &ZwaveSerialPortIndex::portRemoved, this, [this](const QString &path) {
+        foreach (Thing *thing, myThings().filterByThingClassId(interfaceThingClassId)) {
+            if (thing->paramValue(interfaceThingPathParamTypeId).toString() == path) {
+                qCWarning(dcZwave()) << "Serial port of" << thing->name() << "disappeared";
+                thing->setStateValue(interfaceConnectedStateTypeId, false);
+            }
+        }
+    });
+    connect(m_serialPortIndex, &ZwaveSerialPortIndex::portAdded, this, [this](const QString &path) {
+        if (!m_zwaveManager)
+            return;
+
+        // The stick is back, maybe under another path. Its driver starts over and the interface
+        // is connected again once the driver reports ready.
+        foreach (Thing *thing, myThings().filterByThingClassId(interfaceThingClassId)) {
+            QString serialNumber = thing->paramValue(interfaceThingSerialNumberParamTypeId).toString();
+            QString previousPath = thing->paramValue(interfaceThingPathParamTypeId).toString();
+            if (serialNumber.isEmpty() ? previousPath != path : findSerialPortPathBySerialnumber(serialNumber) != path)
+                continue;
+
+            qCDebug(dcZwave()) << "Serial port of" << thing->name() << "is back at" << path;
+            m_zwaveManager->removeDriver(previousPath);
+            thing->setParamValue(interfaceThingPathParamTypeId, path);
+            if (!m_zwaveManager->addDriver(path)) {
+                qCWarning(dcZwave()) << "Could not add driver for" << thing->name();
+            }
+        }
+    });
+
+    m_bulkTimer = new QTimer(this);
+    m_bulkTimer->setSingleShot(true);
+    m_bulkTimer->setInterval(0);
+    connect(m_bulkTimer, &QTimer::timeout, this, &IntegrationPluginZwave::sendBulkCommands);
+
+    // State changes of one event loop iteration are written in one pass
+    m_stateTimer = new QTimer(this);
+    m_stateTimer->setSingleShot(true);
+    m_stateTimer->setInterval(0);
+    connect(m_stateTimer, &QTimer::timeout, this, &IntegrationPluginZwave::applyStates);
+
+    // Averages, minimums and maximums move on while a value doesn't report
+    m_historyTimer = new QTimer(this);
+    m_historyTimer->setInterval(10000);
+    connect(m_historyTimer, &QTimer::timeout, this, [this]() {
+        if (m_stateBindings.expire() > 0 && !m_stateTimer->isActive()) {
+            m_stateTimer->start();
+        }
+    });
+    m_historyTimer->start();
+
+    connect(this, &IntegrationPluginZwave::configValueChanged, this, [this](const ParamTypeId &paramTypeId, const QVariant &value) {
+        if (!m_zwaveManager)
+            return;
+
+        if (paramTypeId == zwavePluginValueCoalescingWindowParamTypeId) {
+            m_zwaveManager->setValueCoalescingWindow(value.toInt());
+        } else if (paramTypeId == zwavePluginPollBudgetParamTypeId) {
+            m_zwaveManager->pollScheduler()->setAirtimeBudget(value.toInt());
+        }
+    });
 }
 
 void IntegrationPluginZwave::discoverThings(ThingDiscoveryInfo *info)
 {
     qCDebug(dcZwave()) << "Discover things";
-    Q_FOREACH (QSerialPortInfo port, QSerialPortInfo::availablePorts()) {
+    foreach (const ZwaveSerialPortIndex::Port &port, m_serialPortIndex->ports()) {
 
-        qCDebug(dcZwave()) << "Found serial port:" << port.portName();
-        qCDebug(dcZwave()) << "     - Manufacturer:" << port.manufacturer();
-        qCDebug(dcZwave()) << "     - Description:" << port.description();
-        qCDebug(dcZwave()) << "     - Serial number:" << port.serialNumber();
-        qCDebug(dcZwave()) << "     - Location:" << port.systemLocation();
-        qCDebug(dcZwave()) << "     - Is busy:" << port.isBusy();
+        qCDebug(dcZwave()) << "Found serial port:" << port.portName;
+        qCDebug(dcZwave()) << "     - Manufacturer:" << port.manufacturer;
+        qCDebug(dcZwave()) << "     - Description:" << port.description;
+        qCDebug(dcZwave()) << "     - Serial number:" << port.serialNumber;
+        qCDebug(dcZwave()) << "     - Location:" << port.path;
+        bool busy = m_serialPortIndex->isBusy(port.path);
+        qCDebug(dcZwave()) << "     - Is busy:" << busy;
 
-        if (port.isBusy())
+        if (busy)
             continue;
 
-        QString serialnumber =  port.serialNumber();
-        if (serialnumber.isEmpty()) {
-            // User model identification instead of the serial number
-            // This won't work properly with multible interface of the same model
-            serialnumber = port.manufacturer() + port.description();
-        }
-        ThingDescriptor thingDescriptor(info->thingClassId(), port.portName(), serialnumber);
+        // Without a serial number the model identifies the interface
+        // This won't work properly with multible interface of the same model
+        QString serialnumber = port.identifier;
+        ThingDescriptor thingDescriptor(info->thingClassId(), port.portName, serialnumber);
         ParamList params;
         if (!serialnumber.isEmpty()) {
             // Some serial interfaces don't have a serial number
@@ -83,11 +166,26 @@ void IntegrationPluginZwave::discoverThings(ThingDiscoveryInfo *info)
                 }
             }
         }
-        params.append(Param(interfaceThingPathParamTypeId, port.systemLocation()));
+        params.append(Param(interfaceThingPathParamTypeId, port.path));
         params.append(Param(interfaceThingSerialNumberParamTypeId, serialnumber));
         thingDescriptor.setParams(params);
         info->addThingDescriptor(thingDescriptor);
     }
+
+    if (m_simulator) {
+        ThingDescriptor thingDescriptor(info->thingClassId(), "Z-Wave simulator", m_simulator->path());
+        foreach (Thing *existingThing, myThings()) {
+            if (existingThing->paramValue(interfaceThingSerialNumberParamTypeId).toString() == ZwaveSimulator::serialNumber()) {
+                thingDescriptor.setThingId(existingThing->id());
+                break;
+            }
+        }
+        ParamList params;
+        params.append(Param(interfaceThingPathParamTypeId, m_simulator->path()));
+        params.append(Param(interfaceThingSerialNumberParamTypeId, ZwaveSimulator::serialNumber()));
+        thingDescriptor.setParams(params);
+        info->addThingDescriptor(thingDescriptor);
+    }
     info->finish(Thing::ThingErrorNoError);
 }
 
@@ -99,13 +197,31 @@ void IntegrationPluginZwave::setupThing(ThingSetupInfo *info)
     if (thing->thingClassId() == interfaceThingClassId) {
 
         if (!m_zwaveManager) {
-            m_zwaveManager = new ZwaveManager(this);
+            m_zwaveManager = new ZwaveManager(m_serialPortIndex, this);
             connect(info, &ThingSetupInfo::aborted, m_zwaveManager, &ZwaveManager::deleteLater);
+            m_zwaveManager->setValueCoalescingWindow(configValue(zwavePluginValueCoalescingWindowParamTypeId).toInt());
+            m_zwaveManager->pollScheduler()->setAirtimeBudget(configValue(zwavePluginPollBudgetParamTypeId).toInt());
 
             if (!m_zwaveManager->init()) {
                 qCWarning(dcZwave()) << "Could not init Z-Wave manager";
                 return info->finish(Thing::ThingErrorHardwareNotAvailable);
             }
+
+            connect(m_zwaveManager, &ZwaveManager::driverEvent, this, &IntegrationPluginZwave::onDriverEvent);
+            connect(m_zwaveManager, &ZwaveManager::initialized, this, &IntegrationPluginZwave::onInitialized);
+            connect(m_zwaveManager, &ZwaveManager::snapshotRestored, this, &IntegrationPluginZwave::onSnapshotRestored);
+            connect(m_zwaveManager, &ZwaveManager::nodeAdded, this, &IntegrationPluginZwave::onNodeAdded);
+            connect(m_zwaveManager, &ZwaveManager::nodeRemoved, this, &IntegrationPluginZwave::onNodeRemoved);
+            connect(m_zwaveManager, &ZwaveManager::valueEvent, this, &IntegrationPluginZwave::onValueEvent);
+            connect(m_zwaveManager, &ZwaveManager::nodeAliveChanged, this, &IntegrationPluginZwave::onNodeAliveChanged);
+            connect(m_zwaveManager, &ZwaveManager::transactionFinished, this, &IntegrationPluginZwave::onTransactionFinished);
+            connect(m_zwaveManager, &ZwaveManager::transactionDeferred, this, &IntegrationPluginZwave::onTransactionDeferred);
+            connect(m_zwaveManager, &ZwaveManager::metricsUpdated, this, &IntegrationPluginZwave::onMetricsUpdated);
+
+            // Node things become usable with the last known state right away, the interview reconciles later
+            m_startupTimer.start();
+            m_firstThingUsable = false;
+            m_zwaveManager->restoreSnapshot();
         }
 
         //TODO cleanup after reconfiguration
@@ -125,14 +241,12 @@ void IntegrationPluginZwave::setupThing(ThingSetupInfo *info)
         }
 
         connect(m_zwaveManager, &ZwaveManager::driverEvent, info, [info, this] (quint32 homeID, ZwaveManager::DriverEvent event) {
-            // TODOs for multi driver:
-            // Check if the homeId is already in the system
-            // If not then it is probably the newly added driver
+            // Each controller reports with its own home ID, match it by the path of this interface
             QString controllerPath = info->thing()->paramValue(interfaceThingPathParamTypeId).toString();
             if (controllerPath == m_zwaveManager->controllerPath(homeID)) {
                 if (event == ZwaveManager::DriverEventReady) {
                     qCDebug(dcZwave()) << "Driver ready for" << info->thing()->name();
-                    info->thing()->setStateValue(interfaceHomeIdStateTypeId, homeID);
+                    setInterfaceHomeId(info->thing(), homeID);
                     info->thing()->setStateValue(interfaceConnectedStateTypeId, true);
                     info->finish(Thing::ThingErrorNoError);
                 } else if (event == ZwaveManager::DriverEventFailed) {
@@ -141,19 +255,17 @@ void IntegrationPluginZwave::setupThing(ThingSetupInfo *info)
             }
         });
 
-        connect(m_zwaveManager, &ZwaveManager::driverEvent, this, &IntegrationPluginZwave::onDriverEvent);
-        connect(m_zwaveManager, &ZwaveManager::initialized, this, &IntegrationPluginZwave::onInitialized);
-        connect(m_zwaveManager, &ZwaveManager::nodeAdded, this, &IntegrationPluginZwave::onNodeAdded);
-        connect(m_zwaveManager, &ZwaveManager::nodeRemoved, this, &IntegrationPluginZwave::onNodeRemoved);
-
         //connect(manager, &ZwaveManager::destroyed, this, [manager, this]{
         //    m_asyncSetup.remove(manager);
         //});
     } else if (thing->thingClassId() == shutterThingClassId) {
+        setupNodeThing(thing);
         return info->finish(Thing::ThingErrorNoError);
     } else if (thing->thingClassId() == plugThingClassId) {
+        setupNodeThing(thing);
         return info->finish(Thing::ThingErrorNoError);
     } else if (thing->thingClassId() == motionSensorThingClassId) {
+        setupNodeThing(thing);
         return info->finish(Thing::ThingErrorNoError);
     } else {
         return info->finish(Thing::ThingErrorThingClassNotFound);
@@ -207,6 +319,12 @@ void IntegrationPluginZwave::executeAction(ThingActionInfo *info)
         } else if (action.actionTypeId() == interfaceAddNodeActionTypeId) {
             m_zwaveManager->addNode(homeId);
             return info->finish(Thing::ThingErrorNoError);
+        } else if (action.actionTypeId() == interfaceDumpDiagnosticsActionTypeId) {
+            m_zwaveManager->dumpDiagnostics();
+            ZwaveStateBindings::Statistics statistics = m_stateBindings.statistics();
+            qCInfo(dcZwave()) << "State updates:" << statistics.queued << "queued," << statistics.applied << "applied,"
+                              << statistics.merged << "merged," << statistics.suppressed << "suppressed as unchanged";
+            return info->finish(Thing::ThingErrorNoError);
         } else {
             return info->finish(Thing::ThingErrorActionTypeNotFound);
         }
@@ -215,48 +333,39 @@ void IntegrationPluginZwave::executeAction(ThingActionInfo *info)
 
         quint8 nodeId = (quint8) thing->paramValue(shutterThingIdParamTypeId).toUInt();
         if (!m_zwaveManager)
-            return;
-        ZwaveNode *node = m_zwaveManager->getNode(nodeId);
+            return info->finish(Thing::ThingErrorHardwareNotAvailable);
+        ZwaveNode *node = getNode(thing);
         if (!node) {
             qCWarning(dcZwave()) << "Could not find note with id" << nodeId;
             return info->finish(Thing::ThingErrorHardwareNotAvailable);
         }
 
         if (action.actionTypeId() == shutterOpenActionTypeId) {
-            foreach (const ValueID &valueId, node->valueIds()) {
-                if (valueId.GetType() == ValueID::ValueType_Button && QString::fromStdString(Manager::Get()->GetValueLabel(valueId)) == "Up") {
-                    if (!m_zwaveManager->pressButton(nodeId, valueId)) {
-                        return;
-                    }
-                }
-            }
+            if (!node->hasRole(ZwaveNode::ValueRoleShutterUp))
+                return info->finish(Thing::ThingErrorHardwareFailure);
+            queueBulkCommand(info, ZwaveManager::CommandPressButton, {node->valueId(ZwaveNode::ValueRoleShutterUp)});
         } else if (action.actionTypeId() == shutterCloseActionTypeId) {
-            foreach (const ValueID &valueId, node->valueIds()) {
-                if (valueId.GetType() == ValueID::ValueType_Button && QString::fromStdString(Manager::Get()->GetValueLabel(valueId)) == "Down") {
-                    if (!m_zwaveManager->pressButton(nodeId, valueId)) {
-                        return;
-                    }
-                }
-            }
+            if (!node->hasRole(ZwaveNode::ValueRoleShutterDown))
+                return info->finish(Thing::ThingErrorHardwareFailure);
+            queueBulkCommand(info, ZwaveManager::CommandPressButton, {node->valueId(ZwaveNode::ValueRoleShutterDown)});
         } else if (action.actionTypeId() == shutterStopActionTypeId) {
-            foreach (const ValueID &valueId, node->valueIds()) {
-                if (valueId.GetType() == ValueID::ValueType_Button && QString::fromStdString(Manager::Get()->GetValueLabel(valueId)) == "Up") {
-                    if (!m_zwaveManager->releaseButton(nodeId, valueId)) {
-                        return;
-                    }
-                }
-                if (valueId.GetType() == ValueID::ValueType_Button && QString::fromStdString(Manager::Get()->GetValueLabel(valueId)) == "Down") {
-                    if (!m_zwaveManager->releaseButton(nodeId, valueId)) {
-                        return;
-                    }
-                }
-            }
+            QList<ValueID> valueIds;
+            if (node->hasRole(ZwaveNode::ValueRoleShutterUp))
+                valueIds.append(node->valueId(ZwaveNode::ValueRoleShutterUp));
+            if (node->hasRole(ZwaveNode::ValueRoleShutterDown))
+                valueIds.append(node->valueId(ZwaveNode::ValueRoleShutterDown));
+            queueBulkCommand(info, ZwaveManager::CommandReleaseButton, valueIds);
         } else {
             return info->finish(Thing::ThingErrorActionTypeNotFound);
         }
     } else if (thing->thingClassId() == plugThingClassId) {
-        if (action.actionTypeId() == plugPowerStateTypeId) {
+        if (action.actionTypeId() == plugPowerActionTypeId) {
+            ZwaveNode *node = getNode(thing);
+            if (!node || !node->hasRole(ZwaveNode::ValueRoleSwitchBinary))
+                return info->finish(Thing::ThingErrorHardwareNotAvailable);
 
+            bool power = action.param(plugPowerActionPowerParamTypeId).value().toBool();
+            queueBulkCommand(info, ZwaveManager::CommandSetBool, {node->valueId(ZwaveNode::ValueRoleSwitchBinary)}, power);
         } else {
             qCWarning(dcZwave()) << "Execute action: action type id not found" << thing->name() << action.actionTypeId();
             return info->finish(Thing::ThingErrorActionTypeNotFound);
@@ -270,10 +379,30 @@ void IntegrationPluginZwave::executeAction(ThingActionInfo *info)
 void IntegrationPluginZwave::thingRemoved(Thing *thing)
 {
     qCDebug(dcZwave()) << "Delete" << thing->name();
-    if (thing->thingClassId() == interfaceThingClassId) {
-        qCDebug(dcZwave()) << "Deleting Z-Wave manager";
-        m_zwaveManager->deleteLater();
-        m_zwaveManager = nullptr;
+    if (m_nodeThingKeys.contains(thing)) {
+        m_nodeThings.remove(m_nodeThingKeys.take(thing));
+    }
+    m_stateBindings.unbind(thing);
+
+    if (thing->thingClassId() == interfaceThingClassId && m_zwaveManager) {
+        // Only this controller goes away, the others keep running
+        m_zwaveManager->removeDriver(thing->paramValue(interfaceThingPathParamTypeId).toString());
+
+        Things interfaces = myThings().filterByThingClassId(interfaceThingClassId);
+        interfaces.removeAll(thing);
+        if (interfaces.isEmpty()) {
+            qCDebug(dcZwave()) << "Deleting Z-Wave manager";
+            m_zwaveManager->deleteLater();
+            m_zwaveManager = nullptr;
+
+            foreach (ThingActionInfo *info, m_pendingActionCounts.keys()) {
+                info->finish(Thing::ThingErrorHardwareNotAvailable);
+            }
+            m_pendingActionCounts.clear();
+            m_pendingActions.clear();
+            m_deferredActions.clear();
+            m_stateBindings.clear();
+        }
     } else if (thing->thingClassId() == shutterThingClassId) {
 
     }
@@ -284,31 +413,299 @@ void IntegrationPluginZwave::thingRemoved(Thing *thing)
     }
 }
 
+void IntegrationPluginZwave::queueBulkCommand(ThingActionInfo *info, ZwaveManager::Command command, const QList<ValueID> &valueIds, const QVariant &value)
+{
+    // Scenes execute their actions within the same event loop iteration. Identical commands
+    // collected until the next iteration go out as one batch instead of one by one.
+    if (valueIds.isEmpty())
+        return info->finish(Thing::ThingErrorHardwareFailure);
+
+    // Rules and scripts can wait a moment, somebody tapping a switch can't
+    ZwaveCommandQueue::Priority priority = ZwaveCommandQueue::PriorityAutomation;
+    if (info->action().triggeredBy() == Action::TriggeredByUser) {
+        priority = ZwaveCommandQueue::PriorityInteractive;
+    }
+
+    QString key = QString::number(command) + ':' + QString::number(priority) + ':' + value.toString();
+    int index = m_bulkCommandIndex.value(key, -1);
+    foreach (const ValueID &valueId, valueIds) {
+        if (index >= 0 && m_bulkValueIndex.value(qMakePair(valueId.GetHomeId(), valueId.GetId()), -1) > index) {
+            index = -1;
+        }
+    }
+    if (index < 0) {
+        index = m_bulkCommands.count();
+        m_bulkCommands.append(BulkCommand());
+        m_bulkCommandIndex.insert(key, index);
+    }
+    foreach (const ValueID &valueId, valueIds) {
+        m_bulkValueIndex.insert(qMakePair(valueId.GetHomeId(), valueId.GetId()), index);
+    }
+
+    BulkCommand &bulkCommand = m_bulkCommands[index];
+    bulkCommand.command = command;
+    bulkCommand.priority = priority;
+    bulkCommand.value = value;
+    bulkCommand.valueIds.append(valueIds);
+    for (int i = 0; i < valueIds.count(); i++) {
+        bulkCommand.owners.append(info);
+    }
+    bulkCommand.infos.append(info);
+
+    // The action is finished once the device confirmed every value it touches
+    m_pendingActionCounts.insert(info, valueIds.count());
+    connect(info, &ThingActionInfo::destroyed, this, [this, info]() {
+        m_pendingActionCounts.remove(info);
+        m_deferredActions.remove(info);
+    });
+
+    if (!m_bulkTimer->isActive()) {
+        m_bulkTimer->start();
+    }
+}
+
+void IntegrationPluginZwave::sendBulkCommands()
+{
+    QList<BulkCommand> bulkCommands;
+    bulkCommands.swap(m_bulkCommands);
+    m_bulkCommandIndex.clear();
+    m_bulkValueIndex.clear();
+
+    if (!m_zwaveManager) {
+        foreach (const BulkCommand &bulkCommand, bulkCommands) {
+            foreach (const QPointer<ThingActionInfo> &info, bulkCommand.infos) {
+                if (info) {
+                    m_pendingActionCounts.remove(info);
+                    info->finish(Thing::ThingErrorHardwareNotAvailable);
+                }
+            }
+        }
+        m_pendingActions.clear();
+        return;
+    }
+
+    foreach (const BulkCommand &bulkCommand, bulkCommands) {
+        if (bulkCommand.infos.count() > 1) {
+            qCDebug(dcZwave()) << "Sending" << bulkCommand.command << "for" << bulkCommand.infos.count() << "actions as one batch";
+        }
+        QList<int> commandIds;
+        m_zwaveManager->sendBatch(bulkCommand.command, bulkCommand.valueIds, bulkCommand.value, bulkCommand.priority, &commandIds);
+        for (int i = 0; i < commandIds.count(); i++) {
+            QPointer<ThingActionInfo> info = bulkCommand.owners.at(i);
+            if (commandIds.at(i) >= 0) {
+                m_pendingActions.insert(commandIds.at(i), info);
+            } else if (info && m_pendingActionCounts.contains(info)) {
+                m_pendingActionCounts.remove(info);
+                info->finish(Thing::ThingErrorHardwareFailure);
+            }
+        }
+    }
+}
+
+void IntegrationPluginZwave::onMetricsUpdated()
+{
+    foreach (Thing *thing, myThings().filterByThingClassId(interfaceThingClassId)) {
+        quint32 homeId = thing->stateValue(interfaceHomeIdStateTypeId).toUInt();
+        thing->setStateValue(interfaceNotificationRateStateTypeId, m_zwaveManager->notificationRate(homeId));
+        thing->setStateValue(interfaceDroppedNotificationsStateTypeId, m_zwaveManager->droppedNotifications(homeId));
+        thing->setStateValue(interfaceCommandQueueDepthStateTypeId, m_zwaveManager->commandQueueDepth(homeId));
+        thing->setStateValue(interfaceActionLatencyStateTypeId, m_zwaveManager->actionLatency());
+    }
+}
+
+void IntegrationPluginZwave::onTransactionFinished(quint32 homeId, quint64 valueId, int commandId, bool success, qint64 latency)
+{
+    Q_UNUSED(homeId)
+    Q_UNUSED(valueId)
+
+    QPointer<ThingActionInfo> info = m_pendingActions.take(commandId);
+    if (!info || !m_pendingActionCounts.contains(info))
+        return;
+
+    if (!success) {
+        qCWarning(dcZwave()) << "Action" << info->action().actionTypeId() << "of" << info->thing()->name() << "failed after" << latency << "ms";
+        m_pendingActionCounts.remove(info);
+        m_deferredActions.remove(info);
+        info->finish(Thing::ThingErrorHardwareFailure);
+        return;
+    }
+
+    if (--m_pendingActionCounts[info] == 0) {
+        qCDebug(dcZwave()) << "Action" << info->action().actionTypeId() << "of" << info->thing()->name() << "confirmed after" << latency << "ms";
+        finishAction(info);
+    }
+}
+
+void IntegrationPluginZwave::onTransactionDeferred(quint32 homeId, quint64 valueId, int commandId)
+{
+    Q_UNUSED(homeId)
+    Q_UNUSED(valueId)
+
+    // A sleeping node gets the command when it wakes up, which can take hours. The action
+    // can't wait that long, it is done once all of its commands are confirmed or held back.
+    QPointer<ThingActionInfo> info = m_pendingActions.take(commandId);
+    if (!info || !m_pendingActionCounts.contains(info))
+        return;
+
+    m_deferredActions.insert(info);
+    if (--m_pendingActionCounts[info] == 0) {
+        qCDebug(dcZwave()) << "Action" << info->action().actionTypeId() << "of" << info->thing()->name() << "waits for the device to wake up";
+        finishAction(info);
+    }
+}
+
+void IntegrationPluginZwave::finishAction(ThingActionInfo *info)
+{
+    m_pendingActionCounts.remove(info);
+    if (m_deferredActions.remove(info)) {
+        info->finish(Thing::ThingErrorNoError, QT_TR_NOOP("The device is asleep, the action is carried out when it wakes up."));
+    } else {
+        info->finish(Thing::ThingErrorNoError);
+    }
+}
+
 QString IntegrationPluginZwave::findSerialPortPathBySerialnumber(const QString &serialNumber) const
 {
-    Q_FOREACH (QSerialPortInfo port, QSerialPortInfo::availablePorts()) {
+    if (m_simulator && serialNumber == ZwaveSimulator::serialNumber())
+        return m_simulator->path();
+
+    return m_serialPortIndex->pathByIdentifier(serialNumber);
+}
 
-        QString portSerialNumber =  port.serialNumber();
-        if (portSerialNumber.isEmpty()) {
-            portSerialNumber = port.manufacturer() + port.description();
+Thing *IntegrationPluginZwave::interfaceThing(quint32 homeId) const
+{
+    foreach (Thing *thing, myThings().filterByThingClassId(interfaceThingClassId)) {
+        if (thing->stateValue(interfaceHomeIdStateTypeId).toUInt() == homeId) {
+            return thing;
         }
-        if (portSerialNumber == serialNumber) {
-            return port.systemLocation();
+    }
+    return nullptr;
+}
+
+ZwaveNode *IntegrationPluginZwave::getNode(Thing *thing) const
+{
+    if (!m_zwaveManager || !m_nodeIdParamTypeIds.contains(thing->thingClassId()))
+        return nullptr;
+
+    quint8 nodeId = static_cast<quint8>(thing->paramValue(m_nodeIdParamTypeIds.value(thing->thingClassId())).toUInt());
+
+    // Things created before the interface became their parent don't know their home ID
+    Thing *parent = myThings().findById(thing->parentId());
+    if (!parent)
+        return m_zwaveManager->getNode(nodeId);
+
+    return m_zwaveManager->getNode(parent->stateValue(interfaceHomeIdStateTypeId).toUInt(), nodeId);
+}
+
+quint64 IntegrationPluginZwave::nodeKey(quint32 homeId, quint8 nodeId)
+{
+    return (static_cast<quint64>(homeId) << 8) | nodeId;
+}
+
+void IntegrationPluginZwave::indexThing(Thing *thing)
+{
+    quint8 nodeId = static_cast<quint8>(thing->paramValue(m_nodeIdParamTypeIds.value(thing->thingClassId())).toUInt());
+
+    // Things without a parent interface are indexed with home ID 0 and match any controller
+    quint32 homeId = 0;
+    Thing *parent = myThings().findById(thing->parentId());
+    if (parent) {
+        homeId = parent->stateValue(interfaceHomeIdStateTypeId).toUInt();
+    }
+
+    quint64 key = nodeKey(homeId, nodeId);
+    if (m_nodeThingKeys.contains(thing)) {
+        quint64 oldKey = m_nodeThingKeys.value(thing);
+        if (m_nodeThings.value(oldKey) == thing) {
+            m_nodeThings.remove(oldKey);
         }
     }
-    return "";
+    m_nodeThings.insert(key, thing);
+    m_nodeThingKeys.insert(thing, key);
 }
 
-bool IntegrationPluginZwave::alreadyAdded(const quint8 &nodeId)
+void IntegrationPluginZwave::setInterfaceHomeId(Thing *interface, quint32 homeId)
 {
+    if (interface->stateValue(interfaceHomeIdStateTypeId).toUInt() == homeId)
+        return;
+
+    // A hard reset gives the controller a new home ID, the index of its nodes follows
+    interface->setStateValue(interfaceHomeIdStateTypeId, homeId);
     foreach (Thing *thing, myThings()) {
-        if (m_nodeIdParamTypeIds.contains(thing->thingClassId())) {
-            if (nodeId == (quint8)thing->paramValue(m_nodeIdParamTypeIds.value(thing->thingClassId())).toUInt()) {
-                return true;
-            }
+        if (thing->parentId() == interface->id() && m_nodeThingKeys.contains(thing)) {
+            indexThing(thing);
         }
     }
-    return false;
+}
+
+Thing *IntegrationPluginZwave::findThing(quint32 homeId, quint8 nodeId) const
+{
+    Thing *thing = m_nodeThings.value(nodeKey(homeId, nodeId));
+    if (!thing) {
+        thing = m_nodeThings.value(nodeKey(0, nodeId));
+    }
+    return thing;
+}
+
+bool IntegrationPluginZwave::alreadyAdded(quint32 homeId, quint8 nodeId)
+{
+    return findThing(homeId, nodeId) != nullptr;
+}
+
+void IntegrationPluginZwave::setupNodeThing(Thing *thing)
+{
+    indexThing(thing);
+    if (ZwaveNode *node = getNode(thing)) {
+        markNodeUsable(thing, node);
+    }
+}
+
+void IntegrationPluginZwave::markNodeUsable(Thing *thing, ZwaveNode *node)
+{
+    thing->setStateValue(m_connectedStateTypeIds.value(thing->thingClassId()), m_zwaveManager->isNodeAlive(node->homeId(), node->nodeId()));
+    bindValues(thing, node);
+
+    if (!m_firstThingUsable) {
+        m_firstThingUsable = true;
+        qCDebug(dcZwave()) << "First thing usable" << m_startupTimer.elapsed() << "ms after start" << (node->restored() ? "(from snapshot)" : "(from interview)");
+    }
+}
+
+void IntegrationPluginZwave::bindValues(Thing *thing, ZwaveNode *node)
+{
+    // Roles may have changed with a new interview, bind from scratch
+    m_stateBindings.unbind(thing);
+
+    QList<quint64> valueIds;
+    foreach (const StateBindingType &bindingType, m_stateBindingTypes.value(thing->thingClassId())) {
+        if (!node->hasRole(bindingType.role))
+            continue;
+
+        quint64 valueId = node->valueId(bindingType.role).GetId();
+        m_stateBindings.bind(thing, node->homeId(), valueId, bindingType.stateTypeId, bindingType.conversion);
+        if (!valueIds.contains(valueId)) {
+            valueIds.append(valueId);
+        }
+    }
+
+    foreach (quint64 valueId, valueIds) {
+        // Values backing a thing state get polled with priority
+        m_zwaveManager->pollScheduler()->setValueBound(node->homeId(), valueId, true);
+        // The cached value is current already, no need to wait for the next report
+        applyValue(node->homeId(), valueId, node->value(valueId));
+    }
+}
+
+void IntegrationPluginZwave::applyValue(quint32 homeId, quint64 valueId, const ZwaveValue &value)
+{
+    if (m_stateBindings.apply(homeId, valueId, value) > 0 && !m_stateTimer->isActive()) {
+        m_stateTimer->start();
+    }
+}
+
+void IntegrationPluginZwave::applyStates()
+{
+    m_stateBindings.flush();
 }
 
 bool IntegrationPluginZwave::setCalibrationMode(const quint8 &nodeId, const bool &calibrationMode)
@@ -337,7 +734,7 @@ void IntegrationPluginZwave::onDriverEvent(quint32 homeID, ZwaveManager::DriverE
     // Both search methods are required
     Q_FOREACH(Thing *thing, myThings().filterByThingClassId(interfaceThingClassId)) {
         if (thing->paramValue(interfaceThingPathParamTypeId).toString() == path) {
-            thing->setStateValue(interfaceHomeIdStateTypeId, homeID);
+            setInterfaceHomeId(thing, homeID);
             if (event == ZwaveManager::DriverEventReady) {
                 thing->setStateValue(interfaceConnectedStateTypeId, true);
             } else if (event == ZwaveManager::DriverEventFailed) {
@@ -353,22 +750,21 @@ void IntegrationPluginZwave::onInitialized()
     ZwaveManager *manager = static_cast<ZwaveManager *>(sender());
     ThingDescriptors descriptorList;
 
-    foreach (ZwaveNode *node, manager->nodes()) {
+    for (ZwaveNode *node : manager->nodes()) {
         //qCDebug(dcZwave()) << "+" << node->name() << node->manufacturerName() << node->productName() << node->deviceType();
 
-        foreach (Thing *thing, myThings()) {
-            if (m_nodeIdParamTypeIds.contains(thing->thingClassId())) {
-                if ((quint8)thing->paramValue(m_nodeIdParamTypeIds.value(thing->thingClassId())).toUInt() == node->nodeId()) {
-                    thing->setStateValue(m_connectedStateTypeIds.value(thing->thingClassId()), true);
-                }
-            }
+        if (Thing *thing = findThing(node->homeId(), node->nodeId())) {
+            markNodeUsable(thing, node);
         }
 
-        // Check if we have found the Qubino shutter
-        if (node->deviceType() == 6656 && !alreadyAdded(node->nodeId())) {
-            ThingDescriptor descriptor(shutterThingClassId);
+        ZwaveDeviceClass deviceClass = ZwaveDeviceClass::classify(node);
+        if (deviceClass.isValid() && !alreadyAdded(node->homeId(), node->nodeId())) {
+            qCDebug(dcZwave()) << "Node" << node->nodeId() << node->productName() << "classified as" << deviceClass;
+            ThingClassId thingClassId = m_deviceClassThingClassIds.value(deviceClass.kind());
+            Thing *parent = interfaceThing(node->homeId());
+            ThingDescriptor descriptor(thingClassId, node->productName(), node->manufacturerName(), parent ? parent->id() : ThingId());
             ParamList params;
-            params.append(Param(shutterThingIdParamTypeId, node->nodeId()));
+            params.append(Param(m_nodeIdParamTypeIds.value(thingClassId), node->nodeId()));
             descriptor.setParams(params);
             descriptorList.append(descriptor);
         }
@@ -376,6 +772,16 @@ void IntegrationPluginZwave::onInitialized()
     emit autoThingsAppeared(descriptorList);
 }
 
+void IntegrationPluginZwave::onSnapshotRestored()
+{
+    ZwaveManager *manager = static_cast<ZwaveManager *>(sender());
+    for (ZwaveNode *node : manager->nodes()) {
+        if (Thing *thing = findThing(node->homeId(), node->nodeId())) {
+            markNodeUsable(thing, node);
+        }
+    }
+}
+
 void IntegrationPluginZwave::onNodesChanged()
 {
     qCDebug(dcZwave()) << "Nodes changed";
@@ -383,30 +789,40 @@ void IntegrationPluginZwave::onNodesChanged()
 
 void IntegrationPluginZwave::onNodeAdded(ZwaveNode *node)
 {
-    qCDebug(dcZwave()) << "On node added " << node->name();
-    qCDebug(dcZwave()) << "     - Manufacturer:" << node->manufacturerName();
-    qCDebug(dcZwave()) << "     - Product name:" << node->productName();
-    qCDebug(dcZwave()) << "     - Device type Id:" << node->deviceType();
-    qCDebug(dcZwave()) << "     - Device type:" << node->deviceTypeString();
+    // Name, product and device type are only known once the interview is complete
+    qCDebug(dcZwave()) << "On node added" << node->homeId() << node->nodeId();
 
-    foreach (Thing *thing, myThings()) {
-        if (m_nodeIdParamTypeIds.contains(thing->thingClassId())) {
-            if ((quint8)thing->paramValue(m_nodeIdParamTypeIds.value(thing->thingClassId())).toUInt() == node->nodeId())
-                thing->setStateValue(m_connectedStateTypeIds.value(thing->thingClassId()), true);
+    if (Thing *thing = findThing(node->homeId(), node->nodeId())) {
+        markNodeUsable(thing, node);
+    }
+}
 
-        }
+void IntegrationPluginZwave::onValueEvent(quint32 homeId, quint8 nodeId, quint64 valueId, ZwaveManager::ValueEvent event)
+{
+    if (event == ZwaveManager::ValueEventRemoved)
+        return;
+
+    ZwaveNode *node = m_zwaveManager->getNode(homeId, nodeId);
+    if (!node)
+        return;
+
+    applyValue(homeId, valueId, node->value(valueId));
+}
+
+void IntegrationPluginZwave::onNodeAliveChanged(quint32 homeId, quint8 nodeId, bool alive)
+{
+    qCDebug(dcZwave()) << "Node" << nodeId << (alive ? "is reachable again" : "is not reachable");
+
+    if (Thing *thing = findThing(homeId, nodeId)) {
+        thing->setStateValue(m_connectedStateTypeIds.value(thing->thingClassId()), alive);
     }
 }
 
-void IntegrationPluginZwave::onNodeRemoved(const quint8 &nodeId)
+void IntegrationPluginZwave::onNodeRemoved(quint32 homeId, quint8 nodeId)
 {
-    qCDebug(dcZwave()) << "Node removed: " << nodeId;
+    qCDebug(dcZwave()) << "Node removed: " << homeId << nodeId;
 
-    foreach (Thing *thing, myThings()) {
-        if (m_nodeIdParamTypeIds.contains(thing->thingClassId())) {
-            if ((quint8)thing->paramValue(m_nodeIdParamTypeIds.value(thing->thingClassId())).toUInt() == nodeId) {
-                emit autoThingDisappeared(thing->id());
-            }
-        }
+    if (Thing *thing = findThing(homeId, nodeId)) {
+        emit autoThingDisappeared(thing->id());
     }
 }
@@ -34,8 +34,16 @@
 #include "integrations/thingmanager.h"
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
 
+#include "zwavedeviceclass.h"
 #include "zwavemanager.h"
+#include "zwaveserialportindex.h"
+#include "zwavesimulator.h"
+#include "zwavestatebindings.h"
 
 class IntegrationPluginZwave : public IntegrationPlugin
 {
@@ -56,21 +64,84 @@ private:
     QHash<ThingClassId, ParamTypeId> m_nodeIdParamTypeIds;
     QHash<ThingClassId, StateTypeId> m_connectedStateTypeIds;
     QHash<ThingClassId, ActionTypeId> m_removeNodeActionTypeIds;
+    QHash<ZwaveDeviceClass::Kind, ThingClassId> m_deviceClassThingClassIds;
+
+    // States of a thing class backed by a value role of its node
+    struct StateBindingType {
+        ZwaveNode::ValueRole role;
+        StateTypeId stateTypeId;
+        ZwaveStateBindings::Conversion conversion;
+    };
+    QHash<ThingClassId, QList<StateBindingType>> m_stateBindingTypes;
+    ZwaveStateBindings m_stateBindings;
+    QTimer *m_stateTimer = nullptr;
+    QTimer *m_historyTimer = nullptr;
+
+    // (homeId, nodeId) -> node thing, maintained by setupThing and thingRemoved
+    QHash<quint64, Thing *> m_nodeThings;
+    QHash<Thing *, quint64> m_nodeThingKeys;
 
     ZwaveManager *m_zwaveManager = nullptr;
+    ZwaveSimulator *m_simulator = nullptr;
+    ZwaveSerialPortIndex *m_serialPortIndex = nullptr;
+
+    // Identical commands of actions arriving in the same event loop iteration
+    struct BulkCommand {
+        ZwaveManager::Command command = ZwaveManager::CommandSetBool;
+        ZwaveCommandQueue::Priority priority = ZwaveCommandQueue::PriorityInteractive;
+        QVariant value;
+        QList<ValueID> valueIds;
+        QList<QPointer<ThingActionInfo>> owners; // The action of each value
+        QList<QPointer<ThingActionInfo>> infos;
+    };
+    // Sent in this order. A command only joins an earlier batch if none of its values is
+    // touched by a later one, otherwise "on" and "off" of one tick could swap places.
+    QList<BulkCommand> m_bulkCommands;
+    QHash<QString, int> m_bulkCommandIndex;
+    QHash<QPair<quint32, quint64>, int> m_bulkValueIndex;
+    QTimer *m_bulkTimer = nullptr;
+
+    // Actions waiting for the confirmation of their values, keyed by command ID
+    QHash<int, QPointer<ThingActionInfo>> m_pendingActions;
+    QHash<ThingActionInfo *, int> m_pendingActionCounts;
+    QSet<ThingActionInfo *> m_deferredActions;
+
+    QElapsedTimer m_startupTimer;
+    bool m_firstThingUsable = false;
     QHash<ZwaveManager *, ThingSetupInfo *> m_asyncSetup;
 
     QString findSerialPortPathBySerialnumber(const QString &serialNumber) const;
-    bool alreadyAdded(const quint8 &nodeId);
+    Thing *interfaceThing(quint32 homeId) const;
+    ZwaveNode *getNode(Thing *thing) const;
+    static quint64 nodeKey(quint32 homeId, quint8 nodeId);
+    void indexThing(Thing *thing);
+    void setInterfaceHomeId(Thing *interface, quint32 homeId);
+    Thing *findThing(quint32 homeId, quint8 nodeId) const;
+    bool alreadyAdded(quint32 homeId, quint8 nodeId);
+    void setupNodeThing(Thing *thing);
+    void markNodeUsable(Thing *thing, ZwaveNode *node);
+    void bindValues(Thing *thing, ZwaveNode *node);
+    void applyValue(quint32 homeId, quint64 valueId, const ZwaveValue &value);
     bool setCalibrationMode(const quint8 &nodeId, const bool &calibrationMode);
 
+    void queueBulkCommand(ThingActionInfo *info, ZwaveManager::Command command, const QList<ValueID> &valueIds, const QVariant &value = QVariant());
+    void finishAction(ThingActionInfo *info);
+
 private slots:
+    void sendBulkCommands();
+    void applyStates();
+    void onTransactionFinished(quint32 homeId, quint64 valueId, int commandId, bool success, qint64 latency);
+    void onTransactionDeferred(quint32 homeId, quint64 valueId, int commandId);
+    void onMetricsUpdated();
     void onDriverEvent(quint32 homeId, ZwaveManager::DriverEvent event);
     void onInitialized();
+    void onSnapshotRestored();
     void onNodesChanged();
 
     void onNodeAdded(ZwaveNode *node);
-    void onNodeRemoved(const quint8 &nodeId);
+    void onNodeRemoved(quint32 homeId, quint8 nodeId);
+    void onNodeAliveChanged(quint32 homeId, quint8 nodeId, bool alive);
+    void onValueEvent(quint32 homeId, quint8 nodeId, quint64 valueId, ZwaveManager::ValueEvent event);
 };
 
 #endif // INTEGRATIONPLUGINZWAVE_H
@@ -18,6 +18,10 @@ isEmpty(PLUGIN_PRI) {
 
 QT += serialport
 
+# The device class table is built at compile time with C++14 constexpr
+CONFIG += c++14 link_pkgconfig
+PKGCONFIG += libudev
+
 LIBS += -L/usr/local/lib/ -lopenzwave
 INCLUDEPATH += /usr/include/openzwave/
 
@@ -33,12 +37,38 @@ message("Open z-wave configurations: $${CONFIG_PATH}")
 
 SOURCES += \
     integrationpluginzwave.cpp \
+    zwavecommandqueue.cpp \
+    zwavecontroller.cpp \
+    zwavedeviceclass.cpp \
+    zwaveliveness.cpp \
     zwavemanager.cpp \
+    zwavemetrics.cpp \
     zwavenode.cpp \
-    zwavevalue.cpp
+    zwavenotificationqueue.cpp \
+    zwavepollscheduler.cpp \
+    zwaveserialportindex.cpp \
+    zwavesimulator.cpp \
+    zwavestatebindings.cpp \
+    zwavetopology.cpp \
+    zwavetrace.cpp \
+    zwavevalue.cpp \
+    zwavevaluehistory.cpp
 
 HEADERS += \
     integrationpluginzwave.h \
+    zwavecommandqueue.h \
+    zwavecontroller.h \
+    zwavedeviceclass.h \
+    zwaveliveness.h \
     zwavemanager.h \
+    zwavemetrics.h \
     zwavenode.h \
-    zwavevalue.h
+    zwavenotificationqueue.h \
+    zwavepollscheduler.h \
+    zwaveserialportindex.h \
+    zwavesimulator.h \
+    zwavestatebindings.h \
+    zwavetopology.h \
+    zwavetrace.h \
+    zwavevalue.h \
+    zwavevaluehistory.h
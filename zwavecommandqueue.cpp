@@ -0,0 +1,195 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavecommandqueue.h"
+#include "extern-plugininfo.h"
+
+ZwaveCommandQueue::ZwaveCommandQueue(QObject *parent) :
+    QObject(parent)
+{
+    qRegisterMetaType<ZwaveCommand>();
+    m_clock.start();
+
+    for (int i = 0; i < PriorityCount; i++) {
+        m_depth[i] = 0;
+        m_expired[i] = 0;
+    }
+}
+
+int ZwaveCommandQueue::enqueue(Priority priority, int type, quint32 homeId, quint64 valueId, const QVariant &value, int deadline)
+{
+    Queues &queues = m_queues[homeId];
+    if (queues.isEmpty()) {
+        queues.resize(PriorityCount);
+    }
+
+    ZwaveCommand command;
+    command.id = m_nextId++;
+    command.priority = priority;
+    command.type = type;
+    command.homeId = homeId;
+    command.valueId = valueId;
+    command.value = value;
+    command.enqueued = m_clock.elapsed();
+    command.deadline = command.enqueued + (deadline > 0 ? deadline : defaultDeadline(priority));
+
+    queues[priority].enqueue(command);
+    m_depth[priority]++;
+    return command.id;
+}
+
+bool ZwaveCommandQueue::contains(Priority priority, quint32 homeId, quint64 valueId) const
+{
+    if (!m_queues.contains(homeId))
+        return false;
+
+    foreach (const ZwaveCommand &command, m_queues.value(homeId).at(priority)) {
+        if (command.valueId == valueId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ZwaveCommandQueue::takeNext(quint32 homeId, ZwaveCommand *command)
+{
+    QHash<quint32, Queues>::iterator it = m_queues.find(homeId);
+    if (it == m_queues.end())
+        return false;
+
+    qint64 now = m_clock.elapsed();
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        QQueue<ZwaveCommand> &queue = (*it)[priority];
+        while (!queue.isEmpty()) {
+            ZwaveCommand next = queue.dequeue();
+            m_depth[priority]--;
+            if (next.deadline < now) {
+                m_expired[priority]++;
+                qCDebug(dcZwave()) << "ZwaveCommandQueue: Dropping" << static_cast<Priority>(priority) << "command" << next.id << "for node" << static_cast<int>((next.valueId >> 24) & 0xff) << "after" << now - next.enqueued << "ms";
+                emit commandExpired(next);
+                continue;
+            }
+            *command = next;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ZwaveCommandQueue::removeNode(quint32 homeId, quint8 nodeId)
+{
+    QHash<quint32, Queues>::iterator it = m_queues.find(homeId);
+    if (it == m_queues.end())
+        return;
+
+    QList<ZwaveCommand> removed;
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        QQueue<ZwaveCommand> &queue = (*it)[priority];
+        QQueue<ZwaveCommand>::iterator command = queue.begin();
+        while (command != queue.end()) {
+            // The node ID lives in bits 24-31 of an OpenZWave value ID
+            if (static_cast<quint8>((command->valueId >> 24) & 0xff) == nodeId) {
+                removed.append(*command);
+                command = queue.erase(command);
+                m_depth[priority]--;
+            } else {
+                ++command;
+            }
+        }
+    }
+
+    // Emitted once the queue is consistent again, receivers might enqueue new commands
+    foreach (const ZwaveCommand &command, removed) {
+        emit commandRemoved(command);
+    }
+}
+
+void ZwaveCommandQueue::clear(quint32 homeId)
+{
+    Queues queues = m_queues.take(homeId);
+    for (int priority = 0; priority < queues.count(); priority++) {
+        m_depth[priority] -= queues.at(priority).count();
+    }
+
+    for (int priority = 0; priority < queues.count(); priority++) {
+        foreach (const ZwaveCommand &command, queues.at(priority)) {
+            emit commandRemoved(command);
+        }
+    }
+}
+
+bool ZwaveCommandQueue::isEmpty() const
+{
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        if (m_depth[priority] > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QList<quint32> ZwaveCommandQueue::homeIds() const
+{
+    return m_queues.keys();
+}
+
+int ZwaveCommandQueue::depth(Priority priority) const
+{
+    return m_depth[priority];
+}
+
+int ZwaveCommandQueue::depth(quint32 homeId, Priority priority) const
+{
+    if (!m_queues.contains(homeId))
+        return 0;
+
+    return m_queues.value(homeId).at(priority).count();
+}
+
+quint64 ZwaveCommandQueue::expiredCommands(Priority priority) const
+{
+    return m_expired[priority];
+}
+
+int ZwaveCommandQueue::defaultDeadline(Priority priority)
+{
+    switch (priority) {
+    case PriorityInteractive:
+        return 5000;
+    case PriorityAutomation:
+        return 30000;
+    case PriorityPoll:
+        return 60000;
+    case PriorityMaintenance:
+    case PriorityCount:
+        break;
+    }
+    return 600000;
+}
@@ -0,0 +1,104 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVECOMMANDQUEUE_H
+#define ZWAVECOMMANDQUEUE_H
+
+#include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QVector>
+#include <QVariant>
+#include <QElapsedTimer>
+
+struct ZwaveCommand
+{
+    int id = 0;
+    int priority = 0;
+    int type = 0;
+    quint32 homeId = 0;
+    quint64 valueId = 0;
+    QVariant value;
+    qint64 enqueued = 0;
+    qint64 deadline = 0;
+};
+
+// Outbound commands of the plugin, queued per controller and priority class before
+// they are handed to OpenZWave. The command type is opaque to the queue. Commands
+// which are not sent before their deadline are dropped.
+class ZwaveCommandQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        PriorityInteractive,
+        PriorityAutomation,
+        PriorityPoll,
+        PriorityMaintenance,
+        PriorityCount
+    };
+    Q_ENUM(Priority)
+
+    explicit ZwaveCommandQueue(QObject *parent = nullptr);
+
+    // A deadline <= 0 uses the default of the priority class, returns the command ID
+    int enqueue(Priority priority, int type, quint32 homeId, quint64 valueId, const QVariant &value = QVariant(), int deadline = 0);
+    bool contains(Priority priority, quint32 homeId, quint64 valueId) const;
+
+    // Takes the next command of the given controller not being past its deadline
+    bool takeNext(quint32 homeId, ZwaveCommand *command);
+    // Commands still waiting are reported as removed
+    void removeNode(quint32 homeId, quint8 nodeId);
+    void clear(quint32 homeId);
+
+    bool isEmpty() const;
+    QList<quint32> homeIds() const;
+    int depth(Priority priority) const;
+    int depth(quint32 homeId, Priority priority) const;
+    quint64 expiredCommands(Priority priority) const;
+
+    static int defaultDeadline(Priority priority);
+
+signals:
+    void commandExpired(const ZwaveCommand &command);
+    void commandRemoved(const ZwaveCommand &command);
+
+private:
+    typedef QVector<QQueue<ZwaveCommand>> Queues;
+    QElapsedTimer m_clock;
+    QHash<quint32, Queues> m_queues;
+    int m_depth[PriorityCount];
+    quint64 m_expired[PriorityCount];
+    int m_nextId = 1;
+};
+
+Q_DECLARE_METATYPE(ZwaveCommand)
+
+#endif // ZWAVECOMMANDQUEUE_H
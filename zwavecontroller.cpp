@@ -0,0 +1,86 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavecontroller.h"
+
+ZwaveController::ZwaveController(const QString &driverPath) :
+    m_driverPath(driverPath),
+    m_homeId(0)
+{
+
+}
+
+QString ZwaveController::driverPath() const
+{
+    return m_driverPath;
+}
+
+quint32 ZwaveController::homeId() const
+{
+    return m_homeId.loadAcquire();
+}
+
+void ZwaveController::setHomeId(quint32 homeId)
+{
+    m_homeId.storeRelease(homeId);
+}
+
+ZwaveNotificationQueue *ZwaveController::queue()
+{
+    return &m_queue;
+}
+
+bool ZwaveController::scheduleDrain()
+{
+    return m_drainScheduled.testAndSetOrdered(0, 1);
+}
+
+void ZwaveController::drainStarted()
+{
+    // Reset first, so a notification arriving while we drain schedules a new wakeup
+    m_drainScheduled.storeRelease(0);
+}
+
+void ZwaveController::countNotification(quint8 type, quint8 nodeId)
+{
+    // Only counters, nobody orders anything by them
+    m_notifications[qMin<int>(type, notificationTypeCount - 1)].fetchAndAddRelaxed(1);
+    m_nodeEvents[nodeId].fetchAndAddRelaxed(1);
+}
+
+quint64 ZwaveController::notifications(quint8 type) const
+{
+    return m_notifications[qMin<int>(type, notificationTypeCount - 1)].loadAcquire();
+}
+
+quint64 ZwaveController::nodeEvents(quint8 nodeId) const
+{
+    return m_nodeEvents[nodeId].loadAcquire();
+}
@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVECONTROLLER_H
+#define ZWAVECONTROLLER_H
+
+#include <QString>
+#include <QAtomicInt>
+
+#include "zwavenotificationqueue.h"
+
+// Per controller (USB stick) context. Every OpenZWave driver runs its own thread,
+// which is the only producer of the controller's notification queue. A stick which
+// floods or hangs therefore only stalls its own queue.
+class ZwaveController
+{
+public:
+    struct Statistics {
+        quint64 notifications = 0;
+        quint64 drains = 0;
+        qint64 latencySum = 0;
+        qint64 latencyMax = 0;
+        qint64 start = 0;
+    };
+
+    explicit ZwaveController(const QString &driverPath = QString());
+
+    QString driverPath() const;
+
+    quint32 homeId() const;
+    void setHomeId(quint32 homeId);
+
+    ZwaveNotificationQueue *queue();
+
+    // Returns true if the caller has to schedule a drain
+    bool scheduleDrain();
+    void drainStarted();
+
+    // Called by the driver thread for every notification
+    void countNotification(quint8 type, quint8 nodeId);
+    quint64 notifications(quint8 type) const;
+    quint64 nodeEvents(quint8 nodeId) const;
+
+    static const int notificationTypeCount = 32;
+
+    QAtomicInteger<quint64> droppedNotifications;
+    quint64 pendingDrops = 0; // Not queued as a marker yet, only touched by the driver thread
+    Statistics statistics;
+
+private:
+    const QString m_driverPath;
+    QAtomicInteger<quint32> m_homeId;
+    QAtomicInt m_drainScheduled;
+    ZwaveNotificationQueue m_queue;
+
+    // 64 bit, a busy network wraps 32 bit counters within weeks
+    QAtomicInteger<quint64> m_notifications[notificationTypeCount];
+    QAtomicInteger<quint64> m_nodeEvents[256];
+};
+
+#endif // ZWAVECONTROLLER_H
@@ -0,0 +1,217 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavedeviceclass.h"
+#include "zwavenode.h"
+
+namespace {
+
+enum KeyKind : quint64 {
+    KeyProduct = 1,
+    KeyDeviceType = 2,
+    KeyGenericSpecific = 3
+};
+
+constexpr quint64 productKey(quint16 manufacturerId, quint16 productType, quint16 productId)
+{
+    return (quint64(KeyProduct) << 48) | (quint64(manufacturerId) << 32) | (quint64(productType) << 16) | productId;
+}
+
+constexpr quint64 deviceTypeKey(quint16 deviceType)
+{
+    return (quint64(KeyDeviceType) << 48) | deviceType;
+}
+
+constexpr quint64 genericSpecificKey(quint8 generic, quint8 specific)
+{
+    return (quint64(KeyGenericSpecific) << 48) | (quint64(generic) << 8) | specific;
+}
+
+constexpr quint32 role(ZwaveNode::ValueRole valueRole)
+{
+    return 1u << valueRole;
+}
+
+struct DeviceEntry {
+    quint64 key;
+    ZwaveDeviceClass::Kind kind;
+    quint32 roles;
+};
+
+constexpr quint32 shutterRoles = role(ZwaveNode::ValueRoleShutterUp) | role(ZwaveNode::ValueRoleShutterDown);
+constexpr quint32 plugRoles = role(ZwaveNode::ValueRoleSwitchBinary);
+constexpr quint32 motionSensorRoles = role(ZwaveNode::ValueRoleSensorBinary);
+
+// Adding a device is adding a line here, the hash below is rebuilt by the compiler
+constexpr DeviceEntry deviceEntries[] = {
+    // Exact products
+    { productKey(0x0159, 0x0003, 0x0052), ZwaveDeviceClass::KindShutter, shutterRoles },        // Qubino Flush Shutter
+    { productKey(0x0159, 0x0003, 0x0053), ZwaveDeviceClass::KindShutter, shutterRoles },        // Qubino Flush Shutter DC
+    { productKey(0x010f, 0x0302, 0x1000), ZwaveDeviceClass::KindShutter, shutterRoles },        // Fibaro Roller Shutter 2
+    { productKey(0x010f, 0x0600, 0x1000), ZwaveDeviceClass::KindPlug, plugRoles },              // Fibaro Wall Plug
+    { productKey(0x0086, 0x0003, 0x0060), ZwaveDeviceClass::KindPlug, plugRoles },              // Aeotec Smart Switch 6
+    { productKey(0x010f, 0x0800, 0x1001), ZwaveDeviceClass::KindMotionSensor, motionSensorRoles }, // Fibaro Motion Sensor
+    { productKey(0x0086, 0x0002, 0x0064), ZwaveDeviceClass::KindMotionSensor, motionSensorRoles }, // Aeotec MultiSensor 6
+
+    // Z-Wave+ device types
+    { deviceTypeKey(0x0701), ZwaveDeviceClass::KindPlug, plugRoles },                           // On/off power switch, plug-in
+    { deviceTypeKey(0x1a00), ZwaveDeviceClass::KindShutter, shutterRoles },                     // Window covering
+
+    // Generic / specific device classes. Only classes naming one kind of device belong here:
+    // binary switch / power switch is also every in-wall relay and binary sensor / routing
+    // sensor is also every door and flood sensor, those need a product or device type entry.
+    { genericSpecificKey(0x11, 0x05), ZwaveDeviceClass::KindShutter, shutterRoles },            // Multilevel switch, motor multiposition
+    { genericSpecificKey(0x11, 0x06), ZwaveDeviceClass::KindShutter, shutterRoles },            // Multilevel switch, motor control class A
+    { genericSpecificKey(0x11, 0x07), ZwaveDeviceClass::KindShutter, shutterRoles },            // Multilevel switch, motor control class B
+    { genericSpecificKey(0x11, 0x08), ZwaveDeviceClass::KindShutter, shutterRoles }             // Multilevel switch, motor control class C
+};
+
+constexpr int deviceEntryCount = sizeof(deviceEntries) / sizeof(deviceEntries[0]);
+constexpr int slotBits = 6;
+constexpr int slotCount = 1 << slotBits;
+static_assert(deviceEntryCount <= slotCount / 2, "Device table is too full for the hash, increase slotBits");
+
+constexpr int slot(quint64 key, quint64 seed)
+{
+    return static_cast<int>(((key ^ seed) * Q_UINT64_C(0x9e3779b97f4a7c15)) >> (64 - slotBits));
+}
+
+constexpr bool collisionFree(quint64 seed)
+{
+    bool used[slotCount] = {};
+    for (int i = 0; i < deviceEntryCount; i++) {
+        int index = slot(deviceEntries[i].key, seed);
+        if (used[index])
+            return false;
+        used[index] = true;
+    }
+    return true;
+}
+
+constexpr quint64 findSeed()
+{
+    for (quint64 seed = 1; seed < 100000; seed++) {
+        if (collisionFree(seed))
+            return seed;
+    }
+    return 0;
+}
+
+constexpr quint64 hashSeed = findSeed();
+static_assert(hashSeed != 0, "No collision free seed for the device table");
+
+struct SlotTable {
+    qint8 entries[slotCount];
+};
+
+constexpr SlotTable buildSlotTable()
+{
+    SlotTable table = {};
+    for (int i = 0; i < slotCount; i++) {
+        table.entries[i] = -1;
+    }
+    for (int i = 0; i < deviceEntryCount; i++) {
+        table.entries[slot(deviceEntries[i].key, hashSeed)] = static_cast<qint8>(i);
+    }
+    return table;
+}
+
+constexpr SlotTable slotTable = buildSlotTable();
+
+const DeviceEntry *lookup(quint64 key)
+{
+    int index = slotTable.entries[slot(key, hashSeed)];
+    if (index < 0 || deviceEntries[index].key != key)
+        return nullptr;
+
+    return &deviceEntries[index];
+}
+
+}
+
+ZwaveDeviceClass::ZwaveDeviceClass(ZwaveDeviceClass::Kind kind, quint32 roles) :
+    m_kind(kind),
+    m_roles(roles)
+{
+
+}
+
+ZwaveDeviceClass ZwaveDeviceClass::classify(const ZwaveNode *node)
+{
+    const quint64 keys[] = {
+        productKey(node->manufacturerId(), node->productType(), node->productId()),
+        deviceTypeKey(node->deviceType()),
+        genericSpecificKey(node->genericClass(), node->specificClass())
+    };
+
+    // The most specific match wins, a node missing the required values stays unknown
+    for (quint64 key : keys) {
+        const DeviceEntry *entry = lookup(key);
+        if (!entry)
+            continue;
+
+        for (int valueRole = 0; valueRole < ZwaveNode::ValueRoleCount; valueRole++) {
+            if ((entry->roles & role(static_cast<ZwaveNode::ValueRole>(valueRole))) && !node->hasRole(static_cast<ZwaveNode::ValueRole>(valueRole))) {
+                return ZwaveDeviceClass();
+            }
+        }
+        return ZwaveDeviceClass(entry->kind, entry->roles);
+    }
+
+    return ZwaveDeviceClass();
+}
+
+bool ZwaveDeviceClass::isValid() const
+{
+    return m_kind != KindUnknown;
+}
+
+ZwaveDeviceClass::Kind ZwaveDeviceClass::kind() const
+{
+    return m_kind;
+}
+
+quint32 ZwaveDeviceClass::roles() const
+{
+    return m_roles;
+}
+
+bool ZwaveDeviceClass::hasRole(int valueRole) const
+{
+    return m_roles & (1u << valueRole);
+}
+
+QDebug operator<<(QDebug debug, const ZwaveDeviceClass &deviceClass)
+{
+    static const char *kindNames[] = { "Unknown", "Shutter", "Plug", "MotionSensor" };
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "ZwaveDeviceClass(" << kindNames[deviceClass.kind()] << ", roles: 0x" << QString::number(deviceClass.roles(), 16) << ")";
+    return debug;
+}
@@ -0,0 +1,71 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVEDEVICECLASS_H
+#define ZWAVEDEVICECLASS_H
+
+#include <QtGlobal>
+#include <QDebug>
+
+class ZwaveNode;
+
+// Classification of a node into the kind of thing it becomes. The known devices are
+// compiled into a perfect hash table (see zwavedeviceclass.cpp), a lookup is at most
+// three probes: the exact product, the Z-Wave+ device type and the generic/specific
+// device class.
+class ZwaveDeviceClass
+{
+public:
+    enum Kind {
+        KindUnknown,
+        KindShutter,
+        KindPlug,
+        KindMotionSensor
+    };
+
+    ZwaveDeviceClass(Kind kind = KindUnknown, quint32 roles = 0);
+
+    static ZwaveDeviceClass classify(const ZwaveNode *node);
+
+    bool isValid() const;
+    Kind kind() const;
+
+    // Bit mask of ZwaveNode::ValueRole a node needs to be usable as this kind
+    quint32 roles() const;
+    bool hasRole(int role) const;
+
+private:
+    Kind m_kind;
+    quint32 m_roles;
+};
+
+QDebug operator<<(QDebug debug, const ZwaveDeviceClass &deviceClass);
+
+#endif // ZWAVEDEVICECLASS_H
@@ -0,0 +1,186 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwaveliveness.h"
+#include "extern-plugininfo.h"
+
+ZwaveLiveness::ZwaveLiveness(QObject *parent) :
+    QObject(parent)
+{
+    m_clock.start();
+    m_slots.resize(slotCount);
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(tickInterval);
+    connect(m_timer, &QTimer::timeout, this, &ZwaveLiveness::advance);
+    m_timer->start();
+}
+
+int ZwaveLiveness::detectionTime()
+{
+    // The quiet deadline and the ping deadline may each be seen one tick late
+    return quietTimeout + pingTimeout + 2 * tickInterval;
+}
+
+void ZwaveLiveness::addNode(quint32 homeId, quint8 nodeId, bool listening)
+{
+    quint64 nodeKey = key(homeId, nodeId);
+    Entry &entry = m_entries[nodeKey];
+    entry.lastHeard = m_clock.elapsed();
+    entry.listening = listening;
+    if (listening && entry.dueTick < 0) {
+        schedule(nodeKey, entry, entry.lastHeard + quietTimeout);
+    }
+}
+
+void ZwaveLiveness::removeNode(quint32 homeId, quint8 nodeId)
+{
+    // Its wheel entry is dropped when the slot comes up
+    m_entries.remove(key(homeId, nodeId));
+}
+
+void ZwaveLiveness::clear(quint32 homeId)
+{
+    for (QHash<quint64, Entry>::iterator it = m_entries.begin(); it != m_entries.end();) {
+        if ((it.key() >> 8) == homeId) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ZwaveLiveness::heard(quint32 homeId, quint8 nodeId)
+{
+    QHash<quint64, Entry>::iterator it = m_entries.find(key(homeId, nodeId));
+    if (it == m_entries.end())
+        return;
+
+    it->lastHeard = m_clock.elapsed();
+    it->pingSent = -1;
+    if (!it->alive) {
+        it->alive = true;
+        qCDebug(dcZwave()) << "ZwaveLiveness: Node" << nodeId << "is alive again";
+        emit aliveChanged(homeId, nodeId, true);
+    }
+}
+
+void ZwaveLiveness::setAlive(quint32 homeId, quint8 nodeId, bool alive)
+{
+    QHash<quint64, Entry>::iterator it = m_entries.find(key(homeId, nodeId));
+    if (it == m_entries.end() || it->alive == alive)
+        return;
+
+    it->alive = alive;
+    it->pingSent = -1;
+    if (alive) {
+        it->lastHeard = m_clock.elapsed();
+    }
+    emit aliveChanged(homeId, nodeId, alive);
+}
+
+bool ZwaveLiveness::contains(quint32 homeId, quint8 nodeId) const
+{
+    return m_entries.contains(key(homeId, nodeId));
+}
+
+bool ZwaveLiveness::isAlive(quint32 homeId, quint8 nodeId) const
+{
+    QHash<quint64, Entry>::const_iterator it = m_entries.constFind(key(homeId, nodeId));
+    return it == m_entries.constEnd() || it->alive;
+}
+
+qint64 ZwaveLiveness::lastHeard(quint32 homeId, quint8 nodeId) const
+{
+    QHash<quint64, Entry>::const_iterator it = m_entries.constFind(key(homeId, nodeId));
+    if (it == m_entries.constEnd())
+        return -1;
+
+    return m_clock.elapsed() - it->lastHeard;
+}
+
+quint64 ZwaveLiveness::key(quint32 homeId, quint8 nodeId)
+{
+    return (static_cast<quint64>(homeId) << 8) | nodeId;
+}
+
+void ZwaveLiveness::schedule(quint64 key, ZwaveLiveness::Entry &entry, qint64 deadline)
+{
+    // Deadlines past the horizon of the wheel land in its last slot and get rescheduled from there
+    qint64 ticks = (deadline - m_tick * tickInterval + tickInterval - 1) / tickInterval;
+    ticks = qBound<qint64>(1, ticks, slotCount - 1);
+    entry.dueTick = m_tick + ticks;
+    m_slots[static_cast<int>(entry.dueTick % slotCount)].append(key);
+}
+
+void ZwaveLiveness::advance()
+{
+    qint64 now = m_clock.elapsed();
+
+    // Catch up with ticks missed while the event loop was blocked
+    while ((m_tick + 1) * tickInterval <= now) {
+        m_tick++;
+        QVector<quint64> due;
+        due.swap(m_slots[static_cast<int>(m_tick % slotCount)]);
+
+        foreach (quint64 nodeKey, due) {
+            QHash<quint64, Entry>::iterator it = m_entries.find(nodeKey);
+            if (it == m_entries.end() || it->dueTick != m_tick)
+                continue;
+
+            Entry &entry = *it;
+            entry.dueTick = -1;
+            if (!entry.listening)
+                continue;
+
+            quint32 homeId = static_cast<quint32>(nodeKey >> 8);
+            quint8 nodeId = static_cast<quint8>(nodeKey & 0xff);
+
+            if (entry.pingSent >= 0 && now - entry.pingSent >= pingTimeout) {
+                // Heard nothing since the ping, not even the acknowledgement
+                entry.pingSent = -1;
+                if (entry.alive) {
+                    entry.alive = false;
+                    qCDebug(dcZwave()) << "ZwaveLiveness: Node" << nodeId << "did not answer a ping, last heard" << (now - entry.lastHeard) / 1000 << "s ago";
+                    emit aliveChanged(homeId, nodeId, false);
+                }
+                schedule(nodeKey, entry, now + quietTimeout);
+            } else if (entry.pingSent >= 0) {
+                schedule(nodeKey, entry, entry.pingSent + pingTimeout);
+            } else if (now - entry.lastHeard >= quietTimeout) {
+                entry.pingSent = now;
+                emit pingRequested(homeId, nodeId);
+                schedule(nodeKey, entry, now + pingTimeout);
+            } else {
+                schedule(nodeKey, entry, entry.lastHeard + quietTimeout);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVELIVENESS_H
+#define ZWAVELIVENESS_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// Tracks when every node was heard from last. Mains powered nodes which stay quiet
+// get a NoOperation ping, a node not answering the ping is considered dead. All
+// deadlines live in one timer wheel driven by a single timer, entries are checked
+// lazily when their slot comes up, so hearing from a node is a hash update only.
+//
+// A listening node is reported dead at most detectionTime() after it went silent.
+// Sleeping nodes are never pinged, they rely on OpenZWave reporting them dead.
+class ZwaveLiveness : public QObject
+{
+    Q_OBJECT
+public:
+    static const int tickInterval = 5 * 1000;
+    static const int slotCount = 128;
+    static const int quietTimeout = 5 * 60 * 1000;
+    static const int pingTimeout = 30 * 1000;
+
+    explicit ZwaveLiveness(QObject *parent = nullptr);
+
+    static int detectionTime();
+
+    void addNode(quint32 homeId, quint8 nodeId, bool listening);
+    void removeNode(quint32 homeId, quint8 nodeId);
+    void clear(quint32 homeId);
+
+    void heard(quint32 homeId, quint8 nodeId);
+    void setAlive(quint32 homeId, quint8 nodeId, bool alive);
+
+    bool contains(quint32 homeId, quint8 nodeId) const;
+    bool isAlive(quint32 homeId, quint8 nodeId) const; // Unknown nodes are alive
+    qint64 lastHeard(quint32 homeId, quint8 nodeId) const; // ms ago, -1 if unknown
+
+signals:
+    void pingRequested(quint32 homeId, quint8 nodeId);
+    void aliveChanged(quint32 homeId, quint8 nodeId, bool alive);
+
+private:
+    struct Entry {
+        qint64 lastHeard = 0;
+        qint64 pingSent = -1;
+        bool listening = true;
+        bool alive = true;
+        qint64 dueTick = -1; // Wheel entries for any other tick are stale
+    };
+
+    static quint64 key(quint32 homeId, quint8 nodeId);
+    void schedule(quint64 key, Entry &entry, qint64 deadline);
+
+    QElapsedTimer m_clock;
+    QTimer *m_timer = nullptr;
+    QHash<quint64, Entry> m_entries;
+    QVector<QVector<quint64>> m_slots;
+    qint64 m_tick = 0;
+
+private slots:
+    void advance();
+};
+
+#endif // ZWAVELIVENESS_H
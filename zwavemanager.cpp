@@ -33,11 +33,28 @@
 #include "nymeasettings.h"
 
 #include <QDebug>
-#include <QSerialPortInfo>
+#include <QThread>
+#include <QMetaEnum>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
 #include <QCoreApplication>
+#include <QJsonDocument>
 
-ZwaveManager::ZwaveManager(QObject *parent) :
-    QObject(parent)
+#include <algorithm>
+
+// A healed node gets a day to prove its new routes before it is healed again
+static const qint64 healCooldown = 24 * 60 * 60 * 1000;
+
+static const quint32 snapshotMagic = 0x5a57534e; // "ZWSN"
+static const quint16 snapshotVersion = 4;
+
+// A command not confirmed by the device within this time has failed
+static const int transactionTimeout = 10000;
+
+ZwaveManager::ZwaveManager(ZwaveSerialPortIndex *serialPortIndex, QObject *parent) :
+    QObject(parent),
+    m_serialPortIndex(serialPortIndex)
 {
     qRegisterMetaType<DriverEvent>("DriverEvent");
     qRegisterMetaType<ValueEvent>("ValueEvent");
@@ -45,6 +62,10 @@ ZwaveManager::ZwaveManager(QObject *parent) :
 
     qCDebug(dcZwave()) << "ZwaveManager: Using Z-Wave library version" << libraryVersion();
 
+    m_clock.start();
+    m_controllers[maxControllers].storeRelease(new ZwaveController());
+    m_units.append(QString());
+
     Options::Create(CONFIG_PATH, NymeaSettings::settingsPath().toStdString(), "");
 
     Options::Get()->AddOptionInt("SaveLogLevel", LogLevel_None );
@@ -53,11 +74,66 @@ ZwaveManager::ZwaveManager(QObject *parent) :
     Options::Get()->AddOptionBool("Logging", false);
     Options::Get()->AddOptionBool("ConsoleOutput", false);
 
-    Options::Get()->AddOptionInt("PollInterval", 500);
-    Options::Get()->AddOptionBool("IntervalBetweenPolls", true);
     Options::Get()->AddOptionBool("ValidateValueChanges", true);
     Options::Get()->Lock();
 
+    m_coalescingTimer = new QTimer(this);
+    m_coalescingTimer->setSingleShot(true);
+    m_coalescingTimer->setInterval(200);
+    connect(m_coalescingTimer, &QTimer::timeout, this, &ZwaveManager::flushValueChanges);
+
+    // Polling is scheduled per value by us, not with the global OpenZWave poll interval
+    m_pollScheduler = new ZwavePollScheduler(this);
+    connect(m_pollScheduler, &ZwavePollScheduler::pollRequested, this, [this](quint32 homeId, quint64 valueId) {
+        // Values not bound to a thing are housekeeping, a poll is stale once the next one is due
+        ZwaveCommandQueue::Priority priority = ZwaveCommandQueue::PriorityPoll;
+        if (m_pollScheduler->priority(homeId, valueId) == ZwavePollScheduler::PriorityUnbound)
+            priority = ZwaveCommandQueue::PriorityMaintenance;
+
+        if (!m_commandQueue->contains(priority, homeId, valueId)) {
+            queueCommand(priority, CommandRefresh, ValueID(homeId, valueId), QVariant(), m_pollScheduler->pollInterval(homeId, valueId));
+        }
+    });
+
+    m_commandQueue = new ZwaveCommandQueue(this);
+    connect(m_commandQueue, &ZwaveCommandQueue::commandExpired, this, &ZwaveManager::onCommandDropped);
+    connect(m_commandQueue, &ZwaveCommandQueue::commandRemoved, this, &ZwaveManager::onCommandDropped);
+
+    m_dispatchTimer = new QTimer(this);
+    m_dispatchTimer->setInterval(100);
+    connect(m_dispatchTimer, &QTimer::timeout, this, &ZwaveManager::dispatchCommands);
+
+    m_metricsTimer = new QTimer(this);
+    m_metricsTimer->setInterval(60000);
+    connect(m_metricsTimer, &QTimer::timeout, this, &ZwaveManager::exportMetrics);
+    m_metricsTimer->start();
+
+    // Neighbor lists and statistics are cached by OpenZWave, sampling them costs no airtime
+    m_topologyTimer = new QTimer(this);
+    m_topologyTimer->setInterval(10 * 60 * 1000);
+    connect(m_topologyTimer, &QTimer::timeout, this, &ZwaveManager::updateTopology);
+    m_topologyTimer->start();
+
+    // Quiet mains powered nodes get a NoOperation frame, one that doesn't answer is reported dead
+    m_liveness = new ZwaveLiveness(this);
+    connect(m_liveness, &ZwaveLiveness::pingRequested, this, [this](quint32 homeId, quint8 nodeId) {
+        // Like polls, a ping only goes out while the controller has nothing better to do
+        ValueID valueId(homeId, nodeId);
+        if (m_commandQueue->contains(ZwaveCommandQueue::PriorityMaintenance, homeId, valueId.GetId()))
+            return;
+        qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeId << "has been quiet, queueing a ping";
+        queueCommand(ZwaveCommandQueue::PriorityMaintenance, CommandTestNode, valueId);
+    });
+    connect(m_liveness, &ZwaveLiveness::aliveChanged, this, &ZwaveManager::nodeAliveChanged);
+
+    m_healTimer = new QTimer(this);
+    m_healTimer->setInterval(60 * 1000);
+    connect(m_healTimer, &QTimer::timeout, this, &ZwaveManager::healNextNode);
+
+    m_wakeUpTimer = new QTimer(this);
+    m_wakeUpTimer->setInterval(1000);
+    connect(m_wakeUpTimer, &QTimer::timeout, this, &ZwaveManager::handOverWakeUpCommands);
+
     m_manager = Manager::Create();
     connect(this, &ZwaveManager::valueEvent, this, &ZwaveManager::onValueEvent);
     connect(this, &ZwaveManager::nodeEvent, this, &ZwaveManager::onNodeEvent);
@@ -66,11 +142,19 @@ ZwaveManager::ZwaveManager(QObject *parent) :
 ZwaveManager::~ZwaveManager()
 {
     qCDebug(dcZwave()) << "ZwaveManager: Shutting down Z-Wave manager";
+    delete m_traceWriter;
+
+    saveSnapshot();
     Options::Destroy();
     if (m_initialized) {
         m_manager->RemoveWatcher(onNotification, this);
     }
     m_manager->Destroy();
+
+    for (int i = 0; i <= maxControllers; i++) {
+        delete m_controllers[i].fetchAndStoreOrdered(nullptr);
+    }
+    qDeleteAll(m_retiredControllers);
 }
 
 QString ZwaveManager::libraryVersion() const
@@ -86,8 +170,29 @@ bool ZwaveManager::addDriver(const QString &driverPath)
         qCWarning(dcZwave()) << "ZwaveManager: Could not find" << driverPath;
         return false;
     }
+
+    // The controller context has to exist before the driver thread starts notifying
+    int index = controllerIndex(driverPath);
+    if (index < 0) {
+        for (int i = 0; i < maxControllers; i++) {
+            if (!m_controllers[i].loadAcquire()) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) {
+            qCWarning(dcZwave()) << "ZwaveManager: Can not handle more than" << maxControllers << "controllers";
+            return false;
+        }
+
+        ZwaveController *controller = new ZwaveController(driverPath);
+        controller->statistics.start = m_clock.elapsed();
+        m_controllers[index].storeRelease(controller);
+    }
+
     if (!m_manager->AddDriver(driverPath.toStdString())) {
         qCWarning(dcZwave()) << "ZwaveManager: Could not add driver" << driverPath;
+        m_retiredControllers.append(m_controllers[index].fetchAndStoreOrdered(nullptr));
         return false;
     }
     return true;
@@ -96,7 +201,69 @@ bool ZwaveManager::addDriver(const QString &driverPath)
 bool ZwaveManager::removeDriver(const QString &driverPath)
 {
     qCDebug(dcZwave()) << "ZwaveManger: Remove driver" << driverPath;
-    return m_manager->RemoveDriver(driverPath.toStdString());
+    // The driver reports all of its nodes removed on the way out, they still exist
+    m_removingDriver = true;
+    bool success = m_manager->RemoveDriver(driverPath.toStdString());
+
+    // The driver thread is gone now, deliver what is left and retire the context. Other
+    // driver threads might still look at it, so it lives until the manager goes away.
+    int index = controllerIndex(driverPath);
+    if (index >= 0) {
+        drainNotifications(index);
+        quint32 homeId = m_controllers[index].loadAcquire()->homeId();
+        m_commandQueue->clear(homeId);
+        m_topology.clear(homeId);
+        m_liveness->clear(homeId);
+        for (int i = m_healQueue.count() - 1; i >= 0; i--) {
+            if (m_healQueue.at(i).first == homeId) {
+                m_healQueue.removeAt(i);
+            }
+        }
+        foreach (const auto &key, m_wakeUpQueues.keys()) {
+            if (key.first == homeId) {
+                dropWakeUpQueue(key.first, key.second);
+            }
+        }
+        m_retiredControllers.append(m_controllers[index].fetchAndStoreOrdered(nullptr));
+    }
+    m_removingDriver = false;
+    return success;
+}
+
+int ZwaveManager::controllerIndex(const QString &driverPath) const
+{
+    for (int i = 0; i < maxControllers; i++) {
+        ZwaveController *controller = m_controllers[i].loadAcquire();
+        if (controller && controller->driverPath() == driverPath) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int ZwaveManager::findController(quint32 homeId, int notificationType)
+{
+    // Called on the OpenZWave driver threads
+    for (int i = 0; i < maxControllers; i++) {
+        ZwaveController *controller = m_controllers[i].loadAcquire();
+        if (controller && homeId != 0 && controller->homeId() == homeId) {
+            return i;
+        }
+    }
+
+    // A ready driver tells us its home ID for the first time, or a new one after a hard reset
+    if (notificationType == Notification::Type_DriverReady) {
+        QString path = QString::fromStdString(m_manager->GetControllerPath(homeId));
+        for (int i = 0; i < maxControllers; i++) {
+            ZwaveController *controller = m_controllers[i].loadAcquire();
+            if (controller && controller->driverPath() == path) {
+                controller->setHomeId(homeId);
+                return i;
+            }
+        }
+    }
+
+    return maxControllers;
 }
 
 QString ZwaveManager::controllerPath(quint32 homeId) const
@@ -106,217 +273,1288 @@ QString ZwaveManager::controllerPath(quint32 homeId) const
     return controllerPath;
 }
 
-void ZwaveManager::softResetController(quint32 homeId)
+void ZwaveManager::softResetController(quint32 homeId)
+{
+    qCDebug(dcZwave()) << "ZwaveManger: Soft reset controller" << homeId;
+    m_manager->SoftReset(homeId);
+}
+
+void ZwaveManager::hardResetController(quint32 homeId)
+{
+    qCDebug(dcZwave()) << "ZwaveManger: Hard reset controller" << homeId;
+    m_manager->ResetController(homeId);
+}
+
+void ZwaveManager::addNode(quint32 homeId)
+{
+    qCDebug(dcZwave()) << "ZwaveManager: Add node ... starting the inclusion process" << homeId;
+    m_manager->AddNode(homeId);
+}
+
+void ZwaveManager::removeNode(quint8 nodeId)
+{
+    Q_UNUSED(nodeId)
+    qCDebug(dcZwave()) << "ZwaveManager: Remove node";
+    //m_manager->RemoveNode()
+}
+
+bool ZwaveManager::init()
+{
+    qCDebug(dcZwave()) << "ZwaveManager: Init";
+
+    if (!m_manager->AddWatcher(onNotification, this)) {
+        qCWarning(dcZwave()) << "ZwaveManager: Could not register notification watcher.";
+        return false;
+    }
+
+    m_initialized = true;
+
+    if (qEnvironmentVariableIsSet("NYMEA_ZWAVE_TRACE")) {
+        m_traceWriter = new ZwaveTraceWriter();
+        if (!m_traceWriter->open(QString::fromUtf8(qgetenv("NYMEA_ZWAVE_TRACE")))) {
+            delete m_traceWriter;
+            m_traceWriter = nullptr;
+        }
+    }
+    return true;
+}
+
+QString ZwaveManager::snapshotFileName() const
+{
+    return NymeaSettings::settingsPath() + "/zwave-nodes.cache";
+}
+
+QString ZwaveManager::metricsFileName() const
+{
+    return NymeaSettings::settingsPath() + "/zwave-metrics.prom";
+}
+
+bool ZwaveManager::restoreSnapshot()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(snapshotFileName());
+    if (!file.open(QFile::ReadOnly)) {
+        qCDebug(dcZwave()) << "ZwaveManager: No node snapshot to restore from" << file.fileName();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != snapshotMagic || version != snapshotVersion) {
+        qCWarning(dcZwave()) << "ZwaveManager: Ignoring node snapshot with unknown format" << file.fileName();
+        return false;
+    }
+
+    QStringList units;
+    quint32 nodeCount = 0;
+    stream >> units >> nodeCount;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(dcZwave()) << "ZwaveManager: Could not read node snapshot" << file.fileName();
+        return false;
+    }
+    // Interned units IDs are stored as they are, the snapshot is restored before any value is added
+    m_units = units;
+
+    for (quint32 i = 0; i < nodeCount && stream.status() == QDataStream::Ok; i++) {
+        quint32 homeId = 0;
+        quint8 nodeId = 0;
+        stream >> homeId >> nodeId;
+
+        ZwaveNode *nodeInfo = insertNode(homeId, nodeId);
+        nodeInfo->m_restored = true;
+        stream >> nodeInfo->m_deviceType >> nodeInfo->m_name >> nodeInfo->m_manufacturerName >> nodeInfo->m_manufacturerId
+               >> nodeInfo->m_productType >> nodeInfo->m_productId >> nodeInfo->m_productName >> nodeInfo->m_deviceTypeString
+               >> nodeInfo->m_genericClass >> nodeInfo->m_specificClass >> nodeInfo->m_listening;
+
+        for (int role = 0; role < ZwaveNode::ValueRoleCount; role++) {
+            stream >> nodeInfo->m_roles[role];
+        }
+
+        quint32 valueCount = 0;
+        stream >> valueCount;
+        for (quint32 j = 0; j < valueCount && stream.status() == QDataStream::Ok; j++) {
+            quint64 valueId = 0;
+            ZwaveValue value;
+            stream >> valueId >> value;
+            nodeInfo->m_valueIdIndex.insert(valueId);
+            nodeInfo->m_valueIds.append(ValueID(homeId, valueId));
+            nodeInfo->m_values.insert(valueId, value);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(dcZwave()) << "ZwaveManager: Node snapshot is truncated" << file.fileName();
+    }
+
+    qCDebug(dcZwave()) << "ZwaveManager: Restored" << m_nodes.count() << "nodes from the snapshot in" << timer.elapsed() << "ms";
+    emit snapshotRestored();
+    return true;
+}
+
+void ZwaveManager::saveSnapshot() const
+{
+    // Never replace a good snapshot with the state of a manager which didn't see any node
+    if (m_nodes.isEmpty())
+        return;
+
+    QSaveFile file(snapshotFileName());
+    if (!file.open(QFile::WriteOnly)) {
+        qCWarning(dcZwave()) << "ZwaveManager: Could not write node snapshot" << file.fileName() << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << snapshotMagic << snapshotVersion << m_units << static_cast<quint32>(m_nodes.count());
+
+    for (ZwaveNode *nodeInfo : m_nodes) {
+        stream << nodeInfo->m_homeId << nodeInfo->m_nodeId << nodeInfo->m_deviceType << nodeInfo->m_name << nodeInfo->m_manufacturerName
+               << nodeInfo->m_manufacturerId << nodeInfo->m_productType << nodeInfo->m_productId << nodeInfo->m_productName
+               << nodeInfo->m_deviceTypeString << nodeInfo->m_genericClass << nodeInfo->m_specificClass << nodeInfo->m_listening;
+
+        for (int role = 0; role < ZwaveNode::ValueRoleCount; role++) {
+            stream << nodeInfo->m_roles[role];
+        }
+
+        stream << static_cast<quint32>(nodeInfo->m_valueIds.count());
+        for (const ValueID &valueId : nodeInfo->m_valueIds) {
+            stream << valueId.GetId() << nodeInfo->m_values.value(valueId.GetId());
+        }
+    }
+
+    if (!file.commit()) {
+        qCWarning(dcZwave()) << "ZwaveManager: Could not write node snapshot" << file.fileName() << file.errorString();
+    }
+}
+
+const QList<ZwaveNode *> &ZwaveManager::nodes() const
+{
+    return m_nodes;
+}
+
+ZwaveNode *ZwaveManager::getNode(quint32 homeId, quint8 nodeId) const
+{
+    QHash<quint32, QVector<ZwaveNode *>>::const_iterator it = m_nodeTables.constFind(homeId);
+    if (it == m_nodeTables.constEnd())
+        return nullptr;
+
+    return it->at(nodeId);
+}
+
+ZwaveNode *ZwaveManager::getNode(const quint8 &nodeId) const
+{
+    // Only for callers which don't know the home ID, there is one table per controller
+    for (QHash<quint32, QVector<ZwaveNode *>>::const_iterator it = m_nodeTables.constBegin(); it != m_nodeTables.constEnd(); ++it) {
+        if (ZwaveNode *node = it->at(nodeId)) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+int ZwaveManager::valueCoalescingWindow() const
+{
+    return m_coalescingTimer->interval();
+}
+
+void ZwaveManager::setValueCoalescingWindow(int msecs)
+{
+    qCDebug(dcZwave()) << "ZwaveManager: Set value coalescing window to" << msecs << "ms";
+    m_coalescingTimer->setInterval(qMax(0, msecs));
+    if (msecs <= 0) {
+        flushValueChanges();
+    }
+}
+
+quint64 ZwaveManager::coalescedValueEvents() const
+{
+    return m_coalescedValueEvents;
+}
+
+ZwavePollScheduler *ZwaveManager::pollScheduler() const
+{
+    return m_pollScheduler;
+}
+
+ZwaveCommandQueue *ZwaveManager::commandQueue() const
+{
+    return m_commandQueue;
+}
+
+const ZwaveTopology &ZwaveManager::topology() const
+{
+    return m_topology;
+}
+
+bool ZwaveManager::isNodeAlive(quint32 homeId, quint8 nodeId) const
+{
+    return m_liveness->isAlive(homeId, nodeId);
+}
+
+int ZwaveManager::notificationRate(quint32 homeId) const
+{
+    return m_notificationRates.value(homeId);
+}
+
+quint64 ZwaveManager::droppedNotifications(quint32 homeId) const
+{
+    for (int i = 0; i < maxControllers; i++) {
+        ZwaveController *controller = m_controllers[i].loadAcquire();
+        if (controller && controller->homeId() == homeId) {
+            return controller->droppedNotifications.loadAcquire();
+        }
+    }
+    return 0;
+}
+
+int ZwaveManager::notificationQueueDepth(quint32 homeId) const
+{
+    for (int i = 0; i < maxControllers; i++) {
+        ZwaveController *controller = m_controllers[i].loadAcquire();
+        if (controller && controller->homeId() == homeId) {
+            return controller->queue()->count();
+        }
+    }
+    return 0;
+}
+
+int ZwaveManager::commandQueueDepth(quint32 homeId) const
+{
+    int depth = 0;
+    for (int i = 0; i < ZwaveCommandQueue::PriorityCount; i++) {
+        depth += m_commandQueue->depth(homeId, static_cast<ZwaveCommandQueue::Priority>(i));
+    }
+    return depth;
+}
+
+int ZwaveManager::actionLatency() const
+{
+    return m_actionLatency;
+}
+
+void ZwaveManager::exportMetrics()
+{
+    qint64 now = m_clock.elapsed();
+    qint64 elapsed = qMax<qint64>(1, now - m_lastMetricsExport);
+    m_lastMetricsExport = now;
+
+    QList<ZwaveController *> controllers;
+    for (int i = 0; i <= maxControllers; i++) {
+        ZwaveController *controller = m_controllers[i].loadAcquire();
+        if (controller) {
+            controllers.append(controller);
+        }
+    }
+
+    // Samples of one metric have to be added in a row
+    m_metrics.clear();
+    QHash<quint32, quint64> totals;
+    foreach (ZwaveController *controller, controllers) {
+        for (int type = 0; type < ZwaveController::notificationTypeCount; type++) {
+            quint64 count = controller->notifications(type);
+            totals[controller->homeId()] += count;
+            if (count > 0) {
+                m_metrics.add("zwave_notifications_total", ZwaveMetrics::TypeCounter, "Notifications received from OpenZWave by type", count,
+                              {{"home", QString::number(controller->homeId())}, {"type", notificationTypeName(type)}});
+            }
+        }
+    }
+
+    // A controller which was removed and added again starts counting from zero
+    m_notificationRates.clear();
+    for (QHash<quint32, quint64>::const_iterator it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        quint64 previous = m_notificationTotals.value(it.key());
+        quint64 delta = it.value() >= previous ? it.value() - previous : it.value();
+        m_notificationRates.insert(it.key(), qRound(delta * 60000.0 / elapsed));
+    }
+    m_notificationTotals = totals;
+
+    foreach (ZwaveController *controller, controllers) {
+        for (int nodeId = 1; nodeId < 256; nodeId++) {
+            quint64 count = controller->nodeEvents(nodeId);
+            if (count > 0) {
+                m_metrics.add("zwave_node_notifications_total", ZwaveMetrics::TypeCounter, "Notifications received from OpenZWave by node", count,
+                              {{"home", QString::number(controller->homeId())}, {"node", QString::number(nodeId)}});
+            }
+        }
+    }
+    foreach (ZwaveController *controller, controllers) {
+        m_metrics.add("zwave_notification_queue_depth", ZwaveMetrics::TypeGauge, "Notifications waiting to be processed", controller->queue()->count(),
+                      {{"home", QString::number(controller->homeId())}});
+    }
+    foreach (ZwaveController *controller, controllers) {
+        m_metrics.add("zwave_notifications_dropped_total", ZwaveMetrics::TypeCounter, "Notifications dropped because the queue was full", controller->droppedNotifications.loadAcquire(),
+                      {{"home", QString::number(controller->homeId())}});
+    }
+
+    QMetaEnum priorities = QMetaEnum::fromType<ZwaveCommandQueue::Priority>();
+    for (int i = 0; i < ZwaveCommandQueue::PriorityCount; i++) {
+        m_metrics.add("zwave_command_queue_depth", ZwaveMetrics::TypeGauge, "Commands waiting to be sent by priority class", m_commandQueue->depth(static_cast<ZwaveCommandQueue::Priority>(i)),
+                      {{"priority", priorities.valueToKey(i)}});
+    }
+    for (int i = 0; i < ZwaveCommandQueue::PriorityCount; i++) {
+        m_metrics.add("zwave_commands_expired_total", ZwaveMetrics::TypeCounter, "Commands dropped after their deadline by priority class", m_commandQueue->expiredCommands(static_cast<ZwaveCommandQueue::Priority>(i)),
+                      {{"priority", priorities.valueToKey(i)}});
+    }
+
+    m_metrics.add("zwave_value_events_coalesced_total", ZwaveMetrics::TypeCounter, "Value events merged into a later one", m_coalescedValueEvents);
+    m_metrics.add("zwave_actions_failed_total", ZwaveMetrics::TypeCounter, "Commands not confirmed by the device", m_transactionStatistics.failed);
+    m_metrics.add("zwave_nodes", ZwaveMetrics::TypeGauge, "Known nodes", m_nodes.count());
+    for (auto it = m_wakeUpQueues.constBegin(); it != m_wakeUpQueues.constEnd(); ++it) {
+        m_metrics.add("zwave_wakeup_queue_length", ZwaveMetrics::TypeGauge, "Commands held back until a sleeping node wakes up", it->commands.count(),
+                      {{"home", QString::number(it.key().first)}, {"node", QString::number(it.key().second)}});
+    }
+    for (auto it = m_wakeUpQueues.constBegin(); it != m_wakeUpQueues.constEnd(); ++it) {
+        m_metrics.add("zwave_wakeup_commands_merged_total", ZwaveMetrics::TypeCounter, "Commands for sleeping nodes replaced by a later one", it->merged,
+                      {{"home", QString::number(it.key().first)}, {"node", QString::number(it.key().second)}});
+    }
+    for (auto it = m_wakeUpQueues.constBegin(); it != m_wakeUpQueues.constEnd(); ++it) {
+        m_metrics.add("zwave_wakeup_windows_total", ZwaveMetrics::TypeCounter, "Wake up windows of a sleeping node", it->windows,
+                      {{"home", QString::number(it.key().first)}, {"node", QString::number(it.key().second)}});
+    }
+    for (auto it = m_wakeUpQueues.constBegin(); it != m_wakeUpQueues.constEnd(); ++it) {
+        m_metrics.add("zwave_wakeup_windows_used_total", ZwaveMetrics::TypeCounter, "Wake up windows used to deliver pending commands", it->usedWindows,
+                      {{"home", QString::number(it.key().first)}, {"node", QString::number(it.key().second)}});
+    }
+    foreach (quint32 homeId, m_topology.homeIds()) {
+        foreach (quint8 nodeId, m_topology.nodeIds(homeId)) {
+            int score = m_topology.node(homeId, nodeId).score;
+            if (score >= 0) {
+                m_metrics.add("zwave_node_link_score", ZwaveMetrics::TypeGauge, "Link quality score of a node from 0 to 100", score,
+                              {{"home", QString::number(homeId)}, {"node", QString::number(nodeId)}});
+            }
+        }
+    }
+    foreach (quint32 homeId, m_topology.homeIds()) {
+        foreach (quint8 nodeId, m_topology.nodeIds(homeId)) {
+            int heals = m_topology.node(homeId, nodeId).heals;
+            if (heals > 0) {
+                m_metrics.add("zwave_node_heals_total", ZwaveMetrics::TypeCounter, "Routes of a node healed because of a low link score", heals,
+                              {{"home", QString::number(homeId)}, {"node", QString::number(nodeId)}});
+            }
+        }
+    }
+    m_metrics.write(metricsFileName());
+
+    // Average latency of the actions confirmed since the last export
+    quint64 actions = m_metrics.actionCount() - m_lastActionCount;
+    if (actions > 0) {
+        m_actionLatency = static_cast<int>((m_metrics.actionLatencySum() - m_lastActionLatencySum) / static_cast<qint64>(actions));
+    }
+    m_lastActionCount = m_metrics.actionCount();
+    m_lastActionLatencySum = m_metrics.actionLatencySum();
+
+    emit metricsUpdated();
+}
+
+int ZwaveManager::sendBatch(Command command, const QList<ValueID> &valueIds, const QVariant &value, ZwaveCommandQueue::Priority priority, QList<int> *commandIds)
+{
+    // OpenZWave has no multicast API, so the commands go out as one burst without waiting
+    // in between, per controller and ordered by node to keep routes warm.
+    QVector<int> order(valueIds.count());
+    for (int i = 0; i < order.count(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&valueIds](int a, int b) {
+        if (valueIds.at(a).GetHomeId() != valueIds.at(b).GetHomeId())
+            return valueIds.at(a).GetHomeId() < valueIds.at(b).GetHomeId();
+        return valueIds.at(a).GetNodeId() < valueIds.at(b).GetNodeId();
+    });
+
+    if (commandIds) {
+        commandIds->clear();
+        commandIds->reserve(valueIds.count());
+        for (int i = 0; i < valueIds.count(); i++) {
+            commandIds->append(-1);
+        }
+    }
+
+    int batchId = m_nextBatchId++;
+    Batch batch;
+    batch.start = m_clock.elapsed();
+    m_batches.insert(batchId, batch);
+
+    foreach (int index, order) {
+        const ValueID &valueId = valueIds.at(index);
+        int commandId = queueCommand(priority, command, valueId, value);
+        if (commandId < 0) {
+            qCWarning(dcZwave()) << "ZwaveManager: Could not send" << command << "to node" << valueId.GetNodeId();
+            m_batches[batchId].complete = false;
+            continue;
+        }
+        if (commandIds) {
+            (*commandIds)[index] = commandId;
+        }
+
+        Transaction transaction;
+        transaction.commandId = commandId;
+        transaction.batchId = batchId;
+        transaction.command = command;
+        transaction.value = value;
+        transaction.queued = m_clock.elapsed();
+        m_transactions[qMakePair(valueId.GetHomeId(), valueId.GetId())].append(transaction);
+        m_batches[batchId].count++;
+        m_batches[batchId].pending++;
+    }
+
+    // Don't wait for the next dispatch round, the queue decides what goes out first. The
+    // caller gets the command IDs before any of them can finish.
+    QTimer::singleShot(0, this, &ZwaveManager::dispatchCommands);
+    qCDebug(dcZwave()) << "ZwaveManager: Queued batch" << batchId << command << "to" << m_batches.value(batchId).count << "values";
+
+    if (m_batches.value(batchId).pending == 0) {
+        finishBatch(batchId);
+    } else {
+        QTimer::singleShot(transactionTimeout, this, [this, batchId]() {
+            expireTransactions(batchId);
+        });
+    }
+    return batchId;
+}
+
+int ZwaveManager::queueCommand(ZwaveCommandQueue::Priority priority, ZwaveManager::Command command, const ValueID &valueId, const QVariant &value, int deadline)
+{
+    ZwaveNode *node = getNode(valueId.GetHomeId(), valueId.GetNodeId());
+    if (!node || (!isNodeCommand(command) && !node->hasValue(valueId.GetId())))
+        return -1;
+
+    int commandId = m_commandQueue->enqueue(priority, command, valueId.GetHomeId(), valueId.GetId(), value, deadline);
+    if (!m_dispatchTimer->isActive()) {
+        m_dispatchTimer->start();
+    }
+    return commandId;
+}
+
+void ZwaveManager::dispatchCommands()
+{
+    // Interactive and automation commands are handed over right away. Polls and maintenance
+    // only go out while OpenZWave's send queue is short, so a switch never waits behind them.
+    static const int maxSendQueueCount = 2;
+
+    foreach (quint32 homeId, m_commandQueue->homeIds()) {
+        int sendQueueCount = m_manager->GetSendQueueCount(homeId);
+        while (true) {
+            bool urgent = m_commandQueue->depth(homeId, ZwaveCommandQueue::PriorityInteractive) > 0
+                    || m_commandQueue->depth(homeId, ZwaveCommandQueue::PriorityAutomation) > 0;
+            if (!urgent && sendQueueCount >= maxSendQueueCount)
+                break;
+
+            ZwaveCommand command;
+            if (!m_commandQueue->takeNext(homeId, &command))
+                break;
+
+            ZwaveNode *node = getNode(command.homeId, static_cast<quint8>((command.valueId >> 24) & 0xff));
+            if (node && !node->listening() && !node->awake()) {
+                deferCommand(command);
+                continue;
+            }
+
+            Command type = static_cast<Command>(command.type);
+            if (!sendCommand(type, ValueID(command.homeId, command.valueId), command.value)) {
+                qCWarning(dcZwave()) << "ZwaveManager: Could not send" << type << "to node" << static_cast<int>((command.valueId >> 24) & 0xff);
+                finishTransaction(command.homeId, command.valueId, command.id, false);
+                continue;
+            }
+            sendQueueCount++;
+
+            if (type == CommandHealNode) {
+                quint8 nodeId = static_cast<quint8>((command.valueId >> 24) & 0xff);
+                qCInfo(dcZwave()) << "ZwaveManager: Healing routes of node" << nodeId << "with link score" << m_topology.node(command.homeId, nodeId).score;
+                m_topology.setHealed(command.homeId, nodeId, m_clock.elapsed());
+            }
+
+            // Buttons and node commands don't report back, everything else is done once the new value is reported
+            if (type == CommandPressButton || type == CommandReleaseButton || isNodeCommand(type)) {
+                finishTransaction(command.homeId, command.valueId, command.id, true);
+            } else if (Transaction *transaction = findTransaction(command.homeId, command.valueId, command.id)) {
+                transaction->sent = m_clock.elapsed();
+            }
+        }
+    }
+
+    if (m_commandQueue->isEmpty()) {
+        m_dispatchTimer->stop();
+    }
+}
+
+void ZwaveManager::deferCommand(const ZwaveCommand &command)
+{
+    // OpenZWave would keep every single command for the wake up. Here only the last one per
+    // value and command type survives, the node gets the result and not the history. Each
+    // configuration parameter is a value of its own, so the last setting of each one is kept.
+    // Only byte parameters can be set so far, wider ones have no command yet.
+    quint8 nodeId = static_cast<quint8>((command.valueId >> 24) & 0xff);
+    WakeUpQueue &queue = m_wakeUpQueues[qMakePair(command.homeId, nodeId)];
+
+    Command type = static_cast<Command>(command.type);
+    int replacedId = -1;
+    for (WakeUpCommand &pending : queue.commands) {
+        // One already handed over stays with OpenZWave, the new command goes out after it
+        if (pending.valueId == command.valueId && pending.type == type && !pending.handedOver) {
+            replacedId = pending.commandId;
+            pending.value = command.value;
+            pending.commandId = command.id;
+            break;
+        }
+    }
+    if (replacedId >= 0) {
+        queue.merged++;
+    } else {
+        WakeUpCommand pending;
+        pending.type = type;
+        pending.valueId = command.valueId;
+        pending.value = command.value;
+        pending.commandId = command.id;
+        queue.commands.append(pending);
+    }
+    queue.lastDeferred = m_clock.elapsed();
+    qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeId << "is asleep, holding back" << type << (replacedId >= 0 ? "(merged)" : "") << "-" << queue.commands.count() << "pending";
+
+    if (!m_wakeUpTimer->isActive()) {
+        m_wakeUpTimer->start();
+    }
+
+    // The command is neither sent nor confirmed, it stays open until the node wakes up. However
+    // long the node sleeps, the command has no deadline. A replaced command is never sent.
+    if (Transaction *transaction = findTransaction(command.homeId, command.valueId, command.id)) {
+        transaction->deferred = true;
+    }
+    emit transactionDeferred(command.homeId, command.valueId, command.id);
+    if (replacedId >= 0) {
+        finishTransaction(command.homeId, command.valueId, replacedId, false);
+    }
+}
+
+int ZwaveManager::WakeUpQueue::held() const
+{
+    int count = 0;
+    for (const WakeUpCommand &command : commands) {
+        if (!command.handedOver) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ZwaveManager::handOverWakeUpCommands()
+{
+    // OpenZWave answers the wake up notification of a node with the commands it has queued for
+    // it, followed by WakeUpNoMoreInformation. It queues that frame before the Awake notification
+    // reaches this thread, anything sent after the node woke up would miss the window. So held
+    // back commands go to OpenZWave while the node still sleeps: shortly before it is due to wake
+    // up according to its wake up interval, or once no more commands came in for a while if the
+    // interval is unknown.
+    static const qint64 settleTime = 2000;
+
+    qint64 now = m_clock.elapsed();
+    QList<QPair<quint32, quint8>> due;
+    bool holding = false;
+    for (auto it = m_wakeUpQueues.constBegin(); it != m_wakeUpQueues.constEnd(); ++it) {
+        if (it->held() == 0)
+            continue;
+
+        // A node awake right now gets the commands once it sleeps again
+        ZwaveNode *node = getNode(it.key().first, it.key().second);
+        qint64 handOver = it->lastDeferred + settleTime;
+        if (node && it->lastWakeUp >= 0 && node->hasRole(ZwaveNode::ValueRoleWakeUpInterval)) {
+            qint64 interval = qRound64(node->value(ZwaveNode::ValueRoleWakeUpInterval).toDouble() * 1000);
+            handOver = qMax(handOver, it->lastWakeUp + interval * 9 / 10);
+        }
+        if (node && !node->awake() && now >= handOver) {
+            due.append(it.key());
+        } else {
+            holding = true;
+        }
+    }
+
+    for (int i = 0; i < due.count(); i++) {
+        handOverCommands(due.at(i).first, due.at(i).second);
+    }
+    if (!holding) {
+        m_wakeUpTimer->stop();
+    }
+}
+
+void ZwaveManager::handOverCommands(quint32 homeId, quint8 nodeId)
+{
+    // OpenZWave keeps them in the wake up queue of the node, they go out first thing in its next window
+    QList<WakeUpCommand> held;
+    QList<WakeUpCommand> &commands = m_wakeUpQueues[qMakePair(homeId, nodeId)].commands;
+    for (int i = 0; i < commands.count();) {
+        if (commands.at(i).handedOver) {
+            i++;
+        } else {
+            held.append(commands.takeAt(i));
+        }
+    }
+    if (held.isEmpty())
+        return;
+
+    qCDebug(dcZwave()) << "ZwaveManager: Handing" << held.count() << "held back commands for node" << nodeId << "over to OpenZWave before it wakes up";
+    for (WakeUpCommand &command : held) {
+        if (!sendCommand(command.type, ValueID(homeId, command.valueId), command.value)) {
+            qCWarning(dcZwave()) << "ZwaveManager: Could not hand" << command.type << "for node" << nodeId << "over";
+            finishTransaction(homeId, command.valueId, command.commandId, false);
+            continue;
+        }
+        command.handedOver = true;
+        m_wakeUpQueues[qMakePair(homeId, nodeId)].commands.append(command);
+    }
+}
+
+void ZwaveManager::onNodeAwake(quint32 homeId, quint8 nodeId, bool awake)
+{
+    ZwaveNode *node = getNode(homeId, nodeId);
+    if (!node || node->m_awake == awake)
+        return;
+
+    node->m_awake = awake;
+    if (node->listening())
+        return;
+
+    qint64 now = m_clock.elapsed();
+    WakeUpQueue &queue = m_wakeUpQueues[qMakePair(homeId, nodeId)];
+    if (!awake) {
+        if (queue.awakeSince >= 0) {
+            queue.awakeTime += now - queue.awakeSince;
+            queue.awakeSince = -1;
+        }
+        // Too late for the window that just ended, they wait in OpenZWave for the next one
+        if (queue.held() > 0) {
+            handOverCommands(homeId, nodeId);
+        }
+        return;
+    }
+
+    queue.windows++;
+    queue.awakeSince = now;
+    queue.lastWakeUp = now;
+
+    // OpenZWave sends what it was handed over in this window, ahead of WakeUpNoMoreInformation.
+    // Commands still held back missed it and stay until the node sleeps again.
+    QList<WakeUpCommand> sent;
+    for (int i = 0; i < queue.commands.count();) {
+        if (queue.commands.at(i).handedOver) {
+            sent.append(queue.commands.takeAt(i));
+        } else {
+            i++;
+        }
+    }
+    if (sent.isEmpty())
+        return;
+
+    qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeId << "woke up, OpenZWave is sending" << sent.count() << "pending commands";
+    queue.flushed += sent.count();
+    queue.usedWindows++;
+
+    QSet<int> batchIds;
+    for (const WakeUpCommand &command : sent) {
+        if (command.type == CommandPressButton || command.type == CommandReleaseButton || isNodeCommand(command.type)) {
+            finishTransaction(homeId, command.valueId, command.commandId, true);
+        } else if (Transaction *transaction = findTransaction(homeId, command.valueId, command.commandId)) {
+            // From now on the usual confirmation timeout applies
+            transaction->sent = now;
+            batchIds.insert(transaction->batchId);
+        }
+    }
+    foreach (int batchId, batchIds) {
+        QTimer::singleShot(transactionTimeout, this, [this, batchId]() {
+            expireTransactions(batchId);
+        });
+    }
+}
+
+void ZwaveManager::dropWakeUpQueue(quint32 homeId, quint8 nodeId)
+{
+    // The node or its controller is gone, nothing held back for it will be sent
+    WakeUpQueue queue = m_wakeUpQueues.take(qMakePair(homeId, nodeId));
+    for (const WakeUpCommand &command : queue.commands) {
+        finishTransaction(homeId, command.valueId, command.commandId, false);
+    }
+}
+
+void ZwaveManager::onCommandDropped(const ZwaveCommand &command)
+{
+    // A value which is never sent, because it expired or its node or controller went
+    // away, will not be confirmed either
+    finishTransaction(command.homeId, command.valueId, command.id, false);
+}
+
+bool ZwaveManager::sendCommand(ZwaveManager::Command command, const ValueID &valueId, const QVariant &value)
 {
-    qCDebug(dcZwave()) << "ZwaveManger: Soft reset controller" << homeId;
-    m_manager->SoftReset(homeId);
+    ZwaveNode *node = getNode(valueId.GetHomeId(), valueId.GetNodeId());
+    if (!node || (!isNodeCommand(command) && !node->hasValue(valueId.GetId())))
+        return false;
+
+    switch (command) {
+    case CommandSetBool:
+        return m_manager->SetValue(valueId, value.toBool());
+    case CommandSetByte:
+        return m_manager->SetValue(valueId, static_cast<quint8>(value.toUInt()));
+    case CommandPressButton:
+        return m_manager->PressButton(valueId);
+    case CommandReleaseButton:
+        return m_manager->ReleaseButton(valueId);
+    case CommandRefresh:
+        return m_manager->RefreshValue(valueId);
+    case CommandHealNode:
+        m_manager->HealNetworkNode(valueId.GetHomeId(), valueId.GetNodeId(), false);
+        return true;
+    case CommandTestNode:
+        m_manager->TestNetworkNode(valueId.GetHomeId(), valueId.GetNodeId(), 1);
+        return true;
+    }
+    return false;
 }
 
-void ZwaveManager::hardResetController(quint32 homeId)
+bool ZwaveManager::isNodeCommand(ZwaveManager::Command command)
 {
-    qCDebug(dcZwave()) << "ZwaveManger: Hard reset controller" << homeId;
-    m_manager->ResetController(homeId);
+    return command == CommandHealNode || command == CommandTestNode;
 }
 
-void ZwaveManager::addNode(quint32 homeId)
+void ZwaveManager::confirmTransaction(quint32 homeId, quint64 valueId, const ZwaveValue &value)
 {
-    qCDebug(dcZwave()) << "ZwaveManager: Add node ... starting the inclusion process" << homeId;
-    m_manager->AddNode(homeId);
+    if (m_transactions.isEmpty())
+        return;
+
+    // The oldest command which went out for this value and asked for the reported value is
+    // the one being answered. Others stay pending until their value shows up or they expire.
+    foreach (const Transaction &transaction, m_transactions.value(qMakePair(homeId, valueId))) {
+        if (transaction.sent < 0)
+            continue;
+
+        bool matches = true;
+        switch (transaction.command) {
+        case CommandSetBool:
+            matches = value.toBool() == transaction.value.toBool();
+            break;
+        case CommandSetByte:
+            matches = value.toByte() == static_cast<quint8>(transaction.value.toUInt());
+            break;
+        case CommandPressButton:
+        case CommandReleaseButton:
+        case CommandRefresh:
+        case CommandHealNode:
+        case CommandTestNode:
+            break;
+        }
+        if (matches) {
+            finishTransaction(homeId, valueId, transaction.commandId, true);
+            return;
+        }
+    }
 }
 
-void ZwaveManager::removeNode(quint8 nodeId)
+void ZwaveManager::finishTransaction(quint32 homeId, quint64 valueId, int commandId, bool success)
 {
-    Q_UNUSED(nodeId)
-    qCDebug(dcZwave()) << "ZwaveManager: Remove node";
-    //m_manager->RemoveNode()
+    QPair<quint32, quint64> key = qMakePair(homeId, valueId);
+    QHash<QPair<quint32, quint64>, QList<Transaction>>::iterator it = m_transactions.find(key);
+    if (it == m_transactions.end())
+        return;
+
+    for (int i = 0; i < it->count(); i++) {
+        if (it->at(i).commandId != commandId)
+            continue;
+
+        Transaction transaction = it->takeAt(i);
+        if (it->isEmpty()) {
+            m_transactions.erase(it);
+        }
+
+        qint64 now = m_clock.elapsed();
+        qint64 latency = now - transaction.queued;
+        if (success) {
+            m_transactionStatistics.count++;
+            // Waiting for a wake up would swamp the latency of everything else
+            if (!transaction.deferred) {
+                m_metrics.recordActionLatency(latency);
+                m_transactionStatistics.latencySum += latency;
+                m_transactionStatistics.latencyMax = qMax(m_transactionStatistics.latencyMax, latency);
+            }
+            qCDebug(dcZwave()) << "ZwaveManager: Command" << commandId << "to node" << static_cast<int>((valueId >> 24) & 0xff) << "confirmed after" << latency << "ms"
+                               << "(round trip" << (transaction.sent >= 0 ? now - transaction.sent : 0) << "ms)";
+        } else {
+            m_transactionStatistics.failed++;
+            qCWarning(dcZwave()) << "ZwaveManager: Command" << commandId << "to node" << static_cast<int>((valueId >> 24) & 0xff) << "failed after" << latency << "ms";
+        }
+        emit transactionFinished(homeId, valueId, commandId, success, latency);
+
+        QHash<int, Batch>::iterator batch = m_batches.find(transaction.batchId);
+        if (batch != m_batches.end()) {
+            batch->complete &= success;
+            if (--batch->pending == 0) {
+                finishBatch(transaction.batchId);
+            }
+        }
+        return;
+    }
 }
 
-bool ZwaveManager::init()
+ZwaveManager::Transaction *ZwaveManager::findTransaction(quint32 homeId, quint64 valueId, int commandId)
 {
-    qCDebug(dcZwave()) << "ZwaveManager: Init";
+    QHash<QPair<quint32, quint64>, QList<Transaction>>::iterator it = m_transactions.find(qMakePair(homeId, valueId));
+    if (it == m_transactions.end())
+        return nullptr;
 
-    if (!m_manager->AddWatcher(onNotification, this)) {
-        qCWarning(dcZwave()) << "ZwaveManager: Could not register notification watcher.";
-        return false;
+    for (int i = 0; i < it->count(); i++) {
+        if (it->at(i).commandId == commandId) {
+            return &(*it)[i];
+        }
     }
-
-    m_initialized = true;
-    return true;
+    return nullptr;
 }
 
-QList<ZwaveNode *> ZwaveManager::nodes() const
+void ZwaveManager::expireTransactions(int batchId)
 {
-    return m_nodes;
+    QList<QPair<QPair<quint32, quint64>, int>> expired;
+    for (QHash<QPair<quint32, quint64>, QList<Transaction>>::const_iterator it = m_transactions.constBegin(); it != m_transactions.constEnd(); ++it) {
+        foreach (const Transaction &transaction, it.value()) {
+            if (transaction.batchId == batchId && !(transaction.deferred && transaction.sent < 0)) {
+                expired.append(qMakePair(it.key(), transaction.commandId));
+            }
+        }
+    }
+
+    for (int i = 0; i < expired.count(); i++) {
+        finishTransaction(expired.at(i).first.first, expired.at(i).first.second, expired.at(i).second, false);
+    }
 }
 
-ZwaveNode *ZwaveManager::getNode(const quint8 &nodeId)
+void ZwaveManager::finishBatch(int batchId)
 {
-    foreach (ZwaveNode *node, nodes()) {
-        if (node->nodeId() == nodeId) {
-            return node;
-        }
+    if (!m_batches.contains(batchId))
+        return;
+
+    Batch batch = m_batches.take(batchId);
+    qint64 duration = m_clock.elapsed() - batch.start;
+    if (batch.complete) {
+        qCDebug(dcZwave()) << "ZwaveManager: Batch" << batchId << "with" << batch.count << "commands completed in" << duration << "ms";
+    } else {
+        qCWarning(dcZwave()) << "ZwaveManager: Batch" << batchId << "with" << batch.count << "commands finished incomplete after" << duration << "ms";
     }
-    return NULL;
+    emit batchFinished(batchId, batch.count, duration, batch.complete);
 }
 
 bool ZwaveManager::pressButton(const quint8 &nodeId, const ValueID &valueId)
 {
-    ZwaveNode *node = getNode(nodeId);
-    if (!node)
-        return false;
-
-    if (!node->valueIds().contains(valueId))
+    Q_UNUSED(nodeId)
+    if (queueCommand(ZwaveCommandQueue::PriorityInteractive, CommandPressButton, valueId) < 0)
         return false;
 
-    return Manager::Get()->PressButton(valueId);
+    dispatchCommands();
+    return true;
 }
 
 bool ZwaveManager::releaseButton(const quint8 &nodeId, const ValueID &valueId)
 {
-    ZwaveNode *node = getNode(nodeId);
-    if (!node)
-        return false;
-
-    if (!node->valueIds().contains(valueId))
+    Q_UNUSED(nodeId)
+    if (queueCommand(ZwaveCommandQueue::PriorityInteractive, CommandReleaseButton, valueId) < 0)
         return false;
 
-    return m_manager->ReleaseButton(valueId);
+    dispatchCommands();
+    return true;
 }
 
 bool ZwaveManager::serialPortAvailable(const QString &driverPath) const
 {
-    foreach (const QSerialPortInfo &info, QSerialPortInfo::availablePorts()) {
-        if (driverPath == info.systemLocation()) {
-            return true;
-        }
-    }
-    return false;
+    if (m_serialPortIndex->contains(driverPath))
+        return true;
+
+    // Pseudo terminals, like the one of the simulator, are not listed as serial ports
+    return driverPath.startsWith("/dev/pts/") && QFile::exists(driverPath);
 }
 
-ZwaveNode *ZwaveManager::getNode(const Notification *notification)
+QString ZwaveManager::units(quint16 unitsId) const
 {
-    foreach (ZwaveNode *nodeInfo, m_nodes) {
-        if (nodeInfo->homeId() == notification->GetHomeId() && nodeInfo->nodeId() == notification->GetNodeId())
-            return nodeInfo;
+    return m_units.value(unitsId);
+}
+
+quint16 ZwaveManager::unitsId(const QString &units)
+{
+    int index = m_units.indexOf(units);
+    if (index < 0) {
+        index = m_units.count();
+        m_units.append(units);
     }
-    return NULL;
+    return static_cast<quint16>(index);
 }
 
-QVariant ZwaveManager::getValue(const ValueID &valueId)
+ZwaveValue ZwaveManager::readValue(const ValueID &valueId)
 {
-    QVariant value;
+    // Called on the OpenZWave thread while the notification is delivered
+    Manager *manager = Manager::Get();
 
     switch (valueId.GetType()) {
     case ValueID::ValueType_Bool: {
         bool boolValue = false;
-        Manager::Get()->GetValueAsBool(valueId, &boolValue);
-        value = QVariant(boolValue);
-        break;
+        manager->GetValueAsBool(valueId, &boolValue);
+        return ZwaveValue::fromBool(boolValue);
     }
     case ValueID::ValueType_Byte: {
         quint8 byteValue = 0;
-        Manager::Get()->GetValueAsByte(valueId, &byteValue);
-        value = QVariant(byteValue);
-        break;
+        manager->GetValueAsByte(valueId, &byteValue);
+        return ZwaveValue::fromByte(byteValue);
     }
     case ValueID::ValueType_Decimal: {
         float floatValue = 0;
-        Manager::Get()->GetValueAsFloat(valueId, &floatValue);
-        value = QVariant(floatValue);
-        break;
+        manager->GetValueAsFloat(valueId, &floatValue);
+        return ZwaveValue::fromDecimal(floatValue);
     }
     case ValueID::ValueType_Int: {
-        int intValue = 0;
-        Manager::Get()->GetValueAsInt(valueId, &intValue);
-        value = QVariant(intValue);
-        break;
+        qint32 intValue = 0;
+        manager->GetValueAsInt(valueId, &intValue);
+        return ZwaveValue::fromInt(intValue);
+    }
+    case ValueID::ValueType_Short: {
+        qint16 shortValue = 0;
+        manager->GetValueAsShort(valueId, &shortValue);
+        return ZwaveValue::fromShort(shortValue);
     }
     case ValueID::ValueType_List: {
-        vector<string> stringList;
-        Manager::Get()->GetValueListItems(valueId, &stringList);
-        //        QVariantList variantList;
-        //        foreach (const string &stringItem, stringList) {
-        //            qCDebug(dcZwave()) << "string item" << QString::fromStdString(stringItem);
-        //        }
-        break;
+        qint32 selection = -1;
+        manager->GetValueListSelection(valueId, &selection);
+        return ZwaveValue::fromListSelection(selection);
+    }
+    case ValueID::ValueType_Button: {
+        bool pressed = false;
+        manager->GetValueAsBool(valueId, &pressed);
+        return ZwaveValue::fromButton(pressed);
+    }
+    default:
+        // Strings, schedules and raw values are not cached
+        return ZwaveValue();
     }
+}
 
-        //        case ValueID::ValueType_Schedule:
-        //            break;
-        //        case ValueID::ValueType_Short:
-        //            break;
-    case ValueID::ValueType_Short: {
-        short shortValue;
-        Manager::Get()->GetValueAsShort(valueId, &shortValue);
-        value = QVariant(shortValue);
-        break;
+void ZwaveManager::updateValue(const ZwaveNotificationRecord &record)
+{
+    ZwaveNode *nodeInfo = getNode(record.homeId, record.nodeId);
+    if (!nodeInfo)
+        return;
+
+    ZwaveValue &value = nodeInfo->m_values[record.valueId];
+    quint16 unitsId = value.unitsId();
+    value = record.value;
+    value.setUnitsId(unitsId);
+}
+
+QString ZwaveManager::notificationTypeName(quint8 type)
+{
+    switch (static_cast<Notification::NotificationType>(type)) {
+    case Notification::Type_ValueAdded:
+        return "ValueAdded";
+    case Notification::Type_ValueRemoved:
+        return "ValueRemoved";
+    case Notification::Type_ValueChanged:
+        return "ValueChanged";
+    case Notification::Type_ValueRefreshed:
+        return "ValueRefreshed";
+    case Notification::Type_Group:
+        return "Group";
+    case Notification::Type_NodeNew:
+        return "NodeNew";
+    case Notification::Type_NodeAdded:
+        return "NodeAdded";
+    case Notification::Type_NodeRemoved:
+        return "NodeRemoved";
+    case Notification::Type_NodeProtocolInfo:
+        return "NodeProtocolInfo";
+    case Notification::Type_NodeNaming:
+        return "NodeNaming";
+    case Notification::Type_NodeEvent:
+        return "NodeEvent";
+    case Notification::Type_PollingDisabled:
+        return "PollingDisabled";
+    case Notification::Type_PollingEnabled:
+        return "PollingEnabled";
+    case Notification::Type_SceneEvent:
+        return "SceneEvent";
+    case Notification::Type_CreateButton:
+        return "CreateButton";
+    case Notification::Type_DeleteButton:
+        return "DeleteButton";
+    case Notification::Type_ButtonOn:
+        return "ButtonOn";
+    case Notification::Type_ButtonOff:
+        return "ButtonOff";
+    case Notification::Type_DriverReady:
+        return "DriverReady";
+    case Notification::Type_DriverFailed:
+        return "DriverFailed";
+    case Notification::Type_DriverReset:
+        return "DriverReset";
+    case Notification::Type_EssentialNodeQueriesComplete:
+        return "EssentialNodeQueriesComplete";
+    case Notification::Type_NodeQueriesComplete:
+        return "NodeQueriesComplete";
+    case Notification::Type_AwakeNodesQueried:
+        return "AwakeNodesQueried";
+    case Notification::Type_AllNodesQueriedSomeDead:
+        return "AllNodesQueriedSomeDead";
+    case Notification::Type_AllNodesQueried:
+        return "AllNodesQueried";
+    case Notification::Type_Notification:
+        return "Notification";
+    case Notification::Type_DriverRemoved:
+        return "DriverRemoved";
+    case Notification::Type_ControllerCommand:
+        return "ControllerCommand";
+    case Notification::Type_NodeReset:
+        return "NodeReset";
+    case Notification::Type_UserAlerts:
+        return "UserAlerts";
+    case Notification::Type_ManufacturerSpecificDBReady:
+        return "ManufacturerSpecificDBReady";
     }
-    case ValueID::ValueType_String: {
-        string stringValue;
-        Manager::Get()->GetValueAsString(valueId, &stringValue);
-        value = QVariant(QString::fromStdString(stringValue));
+    return QString::number(type);
+}
+
+void ZwaveManager::onNotification(const Notification *notification, void *context)
+{
+    // Runs on the OpenZWave thread: copy what we need and hand it over to the Qt thread
+    ZwaveManager *manager = static_cast<ZwaveManager *>(context);
+
+    ZwaveNotificationRecord record;
+    record.timestamp = manager->m_clock.nsecsElapsed();
+    record.type = static_cast<quint8>(notification->GetType());
+    record.homeId = notification->GetHomeId();
+    record.nodeId = notification->GetNodeId();
+    record.valueId = notification->GetValueID().GetId();
+
+    switch (notification->GetType()) {
+    case Notification::Type_ValueAdded:
+    case Notification::Type_ValueChanged:
+    case Notification::Type_ValueRefreshed:
+        record.value = readValue(notification->GetValueID());
         break;
+    case Notification::Type_Notification:
+        record.code = notification->GetNotification();
+        break;
+    case Notification::Type_NodeEvent:
+    case Notification::Type_ControllerCommand:
+        record.code = notification->GetEvent();
+        break;
+    default:
+        break;
+    }
+
+    manager->deliverNotification(record);
+}
+
+void ZwaveManager::deliverNotification(const ZwaveNotificationRecord &record)
+{
+    // Each driver thread only feeds the queue of its own controller. Notifications without a
+    // known controller share the last slot; OpenZWave delivers notifications under its
+    // notification mutex, so there is still only one producer at a time.
+    int index = findController(record.homeId, record.type);
+    ZwaveController *controller = m_controllers[index].loadAcquire();
+    controller->countNotification(record.type, record.nodeId);
+
+    // Drops since the last queued record are marked in the queue first, so a trace shows where
+    // notifications are missing. Nothing else may overtake the marker.
+    if (controller->pendingDrops > 0) {
+        ZwaveNotificationRecord marker;
+        marker.timestamp = record.timestamp;
+        marker.type = ZwaveNotificationRecord::TypeDropped;
+        marker.homeId = record.homeId;
+        marker.valueId = controller->pendingDrops;
+        if (controller->queue()->push(marker)) {
+            controller->pendingDrops = 0;
+        }
+    }
+
+    // Never wait here: OpenZWave holds its global notification mutex while calling us, so
+    // waiting for one full queue would stall the notifications of every other stick too.
+    // A full queue drops the notification. Only the first drop is logged, the rest is counted.
+    if (controller->pendingDrops > 0 || !controller->queue()->push(record)) {
+        controller->pendingDrops++;
+        if (controller->droppedNotifications.fetchAndAddRelaxed(1) == 0) {
+            qCWarning(dcZwave()) << "ZwaveManager: Notification queue of" << controller->driverPath() << "full. Dropping notifications, starting with" << static_cast<int>(record.type);
+        }
+        return;
+    }
+
+    if (controller->scheduleDrain()) {
+        QMetaObject::invokeMethod(this, "drainNotifications", Qt::QueuedConnection, Q_ARG(int, index));
+    }
+}
+
+void ZwaveManager::drainNotifications(int index)
+{
+    ZwaveController *controller = m_controllers[index].loadAcquire();
+    if (!controller)
+        return;
+
+    controller->drainStarted();
+
+    // Drain in slices, other controllers with pending notifications get their turn in between
+    ZwaveNotificationRecord records[64];
+    ZwaveController::Statistics &statistics = controller->statistics;
+    int drained = 0;
+    int count = 0;
+    while ((count = controller->queue()->pop(records, 64)) > 0) {
+        qint64 now = m_clock.nsecsElapsed();
+        for (int i = 0; i < count; i++) {
+            qint64 latency = now - records[i].timestamp;
+            statistics.latencySum += latency;
+            statistics.latencyMax = qMax(statistics.latencyMax, latency);
+            if (m_traceWriter) {
+                m_traceWriter->write(records[i]);
+            }
+            if (records[i].type == ZwaveNotificationRecord::TypeDropped)
+                continue;
+            processNotification(records[i]);
+        }
+        statistics.notifications += count;
+        drained += count;
+
+        if (drained >= 512) {
+            if (controller->scheduleDrain()) {
+                QMetaObject::invokeMethod(this, "drainNotifications", Qt::QueuedConnection, Q_ARG(int, index));
+            }
+            break;
+        }
+    }
+    statistics.drains++;
+
+    qint64 elapsed = m_clock.elapsed() - statistics.start;
+    if (elapsed >= 10000) {
+        if (statistics.notifications > 0) {
+            qCDebug(dcZwave()) << "ZwaveManager: Notification statistics" << controller->driverPath() << controller->homeId()
+                               << qRound(statistics.notifications * 1000.0 / elapsed) << "notifications/s,"
+                               << statistics.notifications / statistics.drains << "per drain,"
+                               << "drain latency avg" << statistics.latencySum / static_cast<qint64>(statistics.notifications) / 1000 << "us"
+                               << "max" << statistics.latencyMax / 1000 << "us,"
+                               << controller->droppedNotifications.loadAcquire() << "dropped,"
+                               << m_coalescedValueEvents << "value events coalesced in total";
+        }
+        statistics = ZwaveController::Statistics();
+        statistics.start = m_clock.elapsed();
     }
+}
+
+void ZwaveManager::flushValueChanges()
+{
+    if (m_pendingValueChanges.isEmpty())
+        return;
+
+    QHash<QPair<quint32, quint64>, ZwaveNotificationRecord> pending;
+    pending.swap(m_pendingValueChanges);
+    foreach (const ZwaveNotificationRecord &record, pending) {
+        emit valueEvent(record.homeId, record.nodeId, record.valueId, record.type == Notification::Type_ValueChanged ? ValueEventChanged : ValueEventRefreshed);
+    }
+}
+
+void ZwaveManager::updateLiveness(const ZwaveNotificationRecord &record)
+{
+    if (record.nodeId == 0)
+        return;
 
-        //        case ValueID::ValueType_Button:
-        //            break;
-        //        case ValueID::ValueType_Raw:
-        //            break;
+    // Only notifications caused by a frame from the node count. Added values, names and protocol
+    // info also come from the cache of OpenZWave, a dead node gets them at every start.
+    switch (record.type) {
+    case Notification::Type_ValueChanged:
+    case Notification::Type_ValueRefreshed:
+    case Notification::Type_NodeEvent:
+    case Notification::Type_SceneEvent:
+        m_liveness->heard(record.homeId, record.nodeId);
+        break;
+    case Notification::Type_Notification:
+        switch (record.code) {
+        case Notification::Code_MsgComplete:
+        case Notification::Code_NoOperation:
+        case Notification::Code_Awake:
+            m_liveness->heard(record.homeId, record.nodeId);
+            break;
+        case Notification::Code_Dead:
+            m_liveness->setAlive(record.homeId, record.nodeId, false);
+            break;
+        case Notification::Code_Alive:
+            m_liveness->setAlive(record.homeId, record.nodeId, true);
+            break;
+        default:
+            break;
+        }
+        break;
     default:
         break;
     }
-    return value;
 }
 
-void ZwaveManager::onNotification(const Notification *notification, void *context)
+void ZwaveManager::processNotification(const ZwaveNotificationRecord &record)
 {
-    ZwaveManager *manager = static_cast<ZwaveManager *>(context);
+    updateLiveness(record);
 
-    switch(notification->GetType()) {
+    switch(record.type) {
     /***********************************
      *          DRIVER EVENTS
      **********************************/
     case Notification::Type_DriverReady: {
-        quint32 homeId = notification->GetHomeId();
-        qCDebug(dcZwave()) << "ZwaveManager: Notification: Driver ready" << homeId;
-        emit manager->driverEvent(homeId, DriverEventReady);
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: Driver ready" << record.homeId;
+        emit driverEvent(record.homeId, DriverEventReady);
         break;
     }
     case Notification::Type_DriverFailed: {
-        quint32 homeId = notification->GetHomeId();
-        qCDebug(dcZwave()) << "ZwaveManager: Notification: Driver failed" << homeId;
-        emit manager->driverEvent(homeId, DriverEventFailed);
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: Driver failed" << record.homeId;
+        emit driverEvent(record.homeId, DriverEventFailed);
         break;
     }
     case Notification::Type_DriverReset: {
-        quint32 homeId = notification->GetHomeId();
-        qCDebug(dcZwave()) << "ZwaveManager: Notification: Driver reset" << homeId;
-        emit manager->driverEvent(homeId, DriverEventReset);
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: Driver reset" << record.homeId;
+        emit driverEvent(record.homeId, DriverEventReset);
         break;
     }
     case Notification::Type_DriverRemoved: {
-        quint32 homeId = notification->GetHomeId();
-        qCDebug(dcZwave()) << "Notification: Driver removed" << homeId;
-        emit manager->driverEvent(homeId, DriverEventRemoved);
+        qCDebug(dcZwave()) << "Notification: Driver removed" << record.homeId;
+        emit driverEvent(record.homeId, DriverEventRemoved);
         break;
     }
         /***********************************
          *          VALUE EVENTS
          **********************************/
     case Notification::Type_ValueAdded: {
-        emit manager->valueEvent(notification->GetHomeId(), notification->GetNodeId(), notification->GetValueID().GetId(), ValueEventAdded);
+        updateValue(record);
+        emit valueEvent(record.homeId, record.nodeId, record.valueId, ValueEventAdded);
         break;
     }
     case Notification::Type_ValueRemoved: {
-        emit manager->valueEvent(notification->GetHomeId(), notification->GetNodeId(), notification->GetValueID().GetId(), ValueEventRemoved);
-        break;
-    }
-    case Notification::Type_ValueChanged: {
-        emit manager->valueEvent(notification->GetHomeId(), notification->GetNodeId(), notification->GetValueID().GetId(), ValueEventChanged);
+        // A pending change for a value which is gone must not be delivered afterwards
+        m_pendingValueChanges.remove(qMakePair(record.homeId, record.valueId));
+        emit valueEvent(record.homeId, record.nodeId, record.valueId, ValueEventRemoved);
         break;
     }
+    case Notification::Type_ValueChanged:
     case Notification::Type_ValueRefreshed: {
-        emit manager->valueEvent(notification->GetHomeId(), notification->GetNodeId(), notification->GetValueID().GetId(), ValueEventRefreshed);
+        // The cache is always current, coalescing only saves the downstream work
+        updateValue(record);
+        m_pollScheduler->valueReported(record.homeId, record.valueId);
+        confirmTransaction(record.homeId, record.valueId, record.value);
+        if (m_coalescingTimer->interval() <= 0) {
+            emit valueEvent(record.homeId, record.nodeId, record.valueId, record.type == Notification::Type_ValueChanged ? ValueEventChanged : ValueEventRefreshed);
+            break;
+        }
+
+        QPair<quint32, quint64> key = qMakePair(record.homeId, record.valueId);
+        QHash<QPair<quint32, quint64>, ZwaveNotificationRecord>::iterator it = m_pendingValueChanges.find(key);
+        if (it == m_pendingValueChanges.end()) {
+            m_pendingValueChanges.insert(key, record);
+        } else {
+            // Keep the latest one, but a change must not be downgraded to a refresh
+            quint8 type = it->type == Notification::Type_ValueChanged ? it->type : record.type;
+            *it = record;
+            it->type = type;
+            m_coalescedValueEvents++;
+        }
+
+        if (!m_coalescingTimer->isActive()) {
+            m_coalescingTimer->start();
+        }
         break;
     }
         /***********************************
@@ -324,18 +1562,24 @@ void ZwaveManager::onNotification(const Notification *notification, void *contex
          **********************************/
     case Notification::Type_NodeNew: {
         qCDebug(dcZwave()) << "ZwaveManager: Notification: New node";
-        emit manager->nodeEvent(notification->GetHomeId(), notification->GetNodeId(), NodeEventNew);
+        emit nodeEvent(record.homeId, record.nodeId, NodeEventNew);
         break;
     }
     case Notification::Type_NodeAdded: {
         qCDebug(dcZwave()) << "ZwaveManager: Notification: Node added";
-        emit manager->nodeEvent(notification->GetHomeId(), notification->GetNodeId(), NodeEventAdded);
+        emit nodeEvent(record.homeId, record.nodeId, NodeEventAdded);
         break;
     }
     case Notification::Type_NodeRemoved: {
-        qCDebug(dcZwave()) << "ZwaveManager: Notification: Node removed";
-
-
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: Node removed" << record.nodeId << (m_removingDriver ? "with its driver" : "");
+        if (m_removingDriver) {
+            // The node and its thing are kept, it is just not reachable any more and doesn't need pings either
+            m_liveness->addNode(record.homeId, record.nodeId, false);
+            m_liveness->setAlive(record.homeId, record.nodeId, false);
+        } else {
+            // Excluded from the network
+            onNodeEvent(record.homeId, record.nodeId, NodeEventRemoved);
+        }
         break;
     }
     case Notification::Type_NodeProtocolInfo: {
@@ -385,6 +1629,13 @@ void ZwaveManager::onNotification(const Notification *notification, void *contex
     }
     case Notification::Type_NodeQueriesComplete: {
         qCDebug(dcZwave()) << "ZwaveManager: Notification: Node queries complete";
+        if (ZwaveNode *nodeInfo = getNode(record.homeId, record.nodeId)) {
+            fetchNodeMetadata(nodeInfo);
+            qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeInfo->nodeId() << nodeInfo->name() << "-" << nodeInfo->manufacturerName() << nodeInfo->productName()
+                               << "- device type" << nodeInfo->deviceType() << nodeInfo->deviceTypeString();
+            buildValueRoles(nodeInfo);
+            schedulePolling(nodeInfo);
+        }
         break;
     }
     case Notification::Type_AwakeNodesQueried: {
@@ -392,57 +1643,196 @@ void ZwaveManager::onNotification(const Notification *notification, void *contex
         break;
     }
     case Notification::Type_AllNodesQueriedSomeDead: {
-        //qCDebug(dcZwave()) << "ZwaveManager: Notification: All nodes queried some dead";
-        emit manager->initialized();
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: All nodes queried some dead";
+        removeRestoredNodes(record.homeId);
+        foreach (ZwaveNode *nodeInfo, m_nodeTables.value(record.homeId)) {
+            if (nodeInfo && m_manager->IsNodeFailed(record.homeId, nodeInfo->nodeId())) {
+                qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeInfo->nodeId() << "is dead";
+                m_liveness->setAlive(record.homeId, nodeInfo->nodeId(), false);
+            }
+        }
+        emit initialized();
+        saveSnapshot();
         break;
     }
     case Notification::Type_AllNodesQueried: {
         qCDebug(dcZwave()) << "ZwaveManager: Notification: All nodes queried";
+        removeRestoredNodes(record.homeId);
 
-        foreach (ZwaveNode *nodeInfo, manager->nodes()) {
-            nodeInfo->m_name = QString::fromStdString(Manager::Get()->GetNodeName(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-            nodeInfo->m_manufacturerName = QString::fromStdString(Manager::Get()->GetNodeManufacturerName(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-            nodeInfo->m_productName = QString::fromStdString(Manager::Get()->GetNodeProductName(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-            nodeInfo->m_deviceTypeString = QString::fromStdString(Manager::Get()->GetNodeDeviceTypeString(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-            nodeInfo->m_deviceType = Manager::Get()->GetNodeDeviceType(nodeInfo->m_homeId, nodeInfo->m_nodeId);
-        }
-
-        emit manager->initialized();
-
-
-        foreach (ZwaveNode *nodeInfo, manager->nodes()) {
-            qCDebug(dcZwave()) << "-----------------------------------------------";
-            qCDebug(dcZwave()) << "Node name       :" << Manager::Get()->GetNodeName(nodeInfo->m_homeId, nodeInfo->m_nodeId).c_str();
-            qCDebug(dcZwave()) << "Manufaturer name:" << Manager::Get()->GetNodeManufacturerName(nodeInfo->m_homeId, nodeInfo->m_nodeId).c_str();
-            qCDebug(dcZwave()) << "Product name    :" << Manager::Get()->GetNodeProductName(nodeInfo->m_homeId, nodeInfo->m_nodeId).c_str();
-            qCDebug(dcZwave()) << "Device type     :" << Manager::Get()->GetNodeDeviceTypeString(nodeInfo->m_homeId, nodeInfo->m_nodeId).c_str();
-            qCDebug(dcZwave()) << "Value count     :" << nodeInfo->valueIds().count();
-            foreach (const ValueID &valueId, nodeInfo->valueIds()) {
-                qCDebug(dcZwave()) << "-------------------------";
-                qCDebug(dcZwave()) << "Value:" << Manager::Get()->GetValueLabel(valueId).c_str() << "("  << manager->valueTypeToString(valueId) <<  ")";
-                qCDebug(dcZwave()) << "\tValue" << manager->getValue(valueId);
-                qCDebug(dcZwave()) << "\tCommand class" << valueId.GetCommandClassId();
-                qCDebug(dcZwave()) << "\tHelp" << Manager::Get()->GetValueHelp(valueId).c_str();
-                qCDebug(dcZwave()) << "\tUnits" << Manager::Get()->GetValueUnits(valueId).c_str();
-                qCDebug(dcZwave()) << "\tMin" << Manager::Get()->GetValueMin(valueId);
-                qCDebug(dcZwave()) << "\tMax" << Manager::Get()->GetValueMax(valueId);
-            }
-            qCDebug(dcZwave()) << "-----------------------------------------------";
+        emit initialized();
+        saveSnapshot();
+
+        // Only worth the Manager round trips if somebody is going to read it
+        if (dcZwave().isDebugEnabled()) {
+            dumpDiagnostics();
         }
         break;
     }
     case Notification::Type_Notification: {
-        qCDebug(dcZwave()) << "ZwaveManager: Notification: Notification";
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: Notification" << static_cast<int>(record.code);
+        if (record.code == Notification::Code_Awake) {
+            onNodeAwake(record.homeId, record.nodeId, true);
+        } else if (record.code == Notification::Code_Sleep) {
+            onNodeAwake(record.homeId, record.nodeId, false);
+        }
         break;
     }
     case Notification::Type_ControllerCommand: {
-        qCDebug(dcZwave()) << "ZwaveManager: Notification: Controller command";
+        qCDebug(dcZwave()) << "ZwaveManager: Notification: Controller command, state" << static_cast<int>(record.code);
         break;
     }
     default: {
-        qCWarning(dcZwave()) << "ZwaveManager: Unhaldled notification received" << notification->GetType() << QString::fromStdString(notification->GetAsString());
+        qCWarning(dcZwave()) << "ZwaveManager: Unhaldled notification received" << static_cast<int>(record.type) << "node" << record.nodeId;
+    }
+
+    }
+}
+
+void ZwaveManager::dumpDiagnostics()
+{
+    for (ZwaveNode *nodeInfo : m_nodes) {
+        qCInfo(dcZwave()) << "-----------------------------------------------";
+        qCInfo(dcZwave()) << "Node            :" << nodeInfo->homeId() << nodeInfo->nodeId() << (nodeInfo->restored() ? "(restored)" : "");
+        qCInfo(dcZwave()) << "Node name       :" << nodeInfo->name();
+        qCInfo(dcZwave()) << "Manufaturer name:" << nodeInfo->manufacturerName();
+        qCInfo(dcZwave()) << "Product name    :" << nodeInfo->productName();
+        qCInfo(dcZwave()) << "Device type     :" << nodeInfo->deviceTypeString();
+        qCInfo(dcZwave()) << "Alive           :" << m_liveness->isAlive(nodeInfo->homeId(), nodeInfo->nodeId())
+                          << "last heard" << m_liveness->lastHeard(nodeInfo->homeId(), nodeInfo->nodeId()) / 1000 << "s ago";
+        qCInfo(dcZwave()) << "Value count     :" << nodeInfo->valueIds().count();
+        for (const ValueID &valueId : nodeInfo->valueIds()) {
+            qCInfo(dcZwave()) << "-------------------------";
+            qCInfo(dcZwave()) << "Value:" << m_manager->GetValueLabel(valueId).c_str() << "("  << valueTypeToString(valueId) <<  ")";
+            qCInfo(dcZwave()) << "\tValue" << nodeInfo->value(valueId.GetId());
+            qCInfo(dcZwave()) << "\tCommand class" << valueId.GetCommandClassId();
+            qCInfo(dcZwave()) << "\tHelp" << m_manager->GetValueHelp(valueId).c_str();
+            qCInfo(dcZwave()) << "\tUnits" << units(nodeInfo->value(valueId.GetId()).unitsId());
+            qCInfo(dcZwave()) << "\tMin" << m_manager->GetValueMin(valueId);
+            qCInfo(dcZwave()) << "\tMax" << m_manager->GetValueMax(valueId);
+        }
+        qCInfo(dcZwave()) << "-----------------------------------------------";
+    }
+
+    for (int i = 0; i < ZwaveCommandQueue::PriorityCount; i++) {
+        ZwaveCommandQueue::Priority priority = static_cast<ZwaveCommandQueue::Priority>(i);
+        qCInfo(dcZwave()) << "Command queue" << priority << "depth" << m_commandQueue->depth(priority) << "expired" << m_commandQueue->expiredCommands(priority);
+    }
+
+    const TransactionStatistics &statistics = m_transactionStatistics;
+    qCInfo(dcZwave()) << "Commands confirmed" << statistics.count << "failed" << statistics.failed << "pending" << m_transactions.count()
+                      << "latency avg" << (statistics.count ? statistics.latencySum / static_cast<qint64>(statistics.count) : 0) << "ms max" << statistics.latencyMax << "ms";
+
+    for (auto it = m_wakeUpQueues.constBegin(); it != m_wakeUpQueues.constEnd(); ++it) {
+        qCInfo(dcZwave()) << "Wake up queue of node" << it.key().second << "pending" << it->commands.count() << "handed over" << it->commands.count() - it->held() << "merged" << it->merged << "sent" << it->flushed
+                          << "windows" << it->windows << "used" << it->usedWindows << "awake avg" << (it->windows ? it->awakeTime / it->windows : 0) << "ms";
+    }
+
+    updateTopology();
+    writeTopology();
+}
+
+void ZwaveManager::writeTopology() const
+{
+    QList<QPair<QString, QByteArray>> files;
+    files.append(qMakePair(NymeaSettings::settingsPath() + "/zwave-topology.json", QJsonDocument(m_topology.toJson()).toJson()));
+    foreach (quint32 homeId, m_topology.homeIds()) {
+        files.append(qMakePair(NymeaSettings::settingsPath() + "/zwave-topology-" + QString::number(homeId, 16) + ".dot",
+                               m_topology.toDot(homeId, m_manager->GetControllerNodeId(homeId))));
+    }
+
+    for (const QPair<QString, QByteArray> &file : files) {
+        QSaveFile saveFile(file.first);
+        if (!saveFile.open(QFile::WriteOnly) || saveFile.write(file.second) != file.second.size() || !saveFile.commit()) {
+            qCWarning(dcZwave()) << "ZwaveManager: Could not write topology" << saveFile.fileName() << saveFile.errorString();
+            continue;
+        }
+        qCInfo(dcZwave()) << "ZwaveManager: Topology written to" << saveFile.fileName();
+    }
+}
+
+void ZwaveManager::updateTopology()
+{
+    qint64 now = m_clock.elapsed();
+
+    for (int i = 0; i < maxControllers; i++) {
+        ZwaveController *controller = m_controllers[i].loadAcquire();
+        if (!controller || controller->homeId() == 0)
+            continue;
+
+        quint32 homeId = controller->homeId();
+        quint8 controllerNodeId = m_manager->GetControllerNodeId(homeId);
+        foreach (ZwaveNode *nodeInfo, m_nodeTables.value(homeId)) {
+            if (!nodeInfo || nodeInfo->nodeId() == controllerNodeId || nodeInfo->restored())
+                continue;
+
+            quint8 nodeId = nodeInfo->nodeId();
+            uint8 *neighborList = nullptr;
+            uint32 neighborCount = m_manager->GetNodeNeighbors(homeId, nodeId, &neighborList);
+            QVector<quint8> neighbors;
+            neighbors.reserve(static_cast<int>(neighborCount));
+            for (uint32 n = 0; n < neighborCount; n++) {
+                neighbors.append(neighborList[n]);
+            }
+            delete[] neighborList;
+
+            Node::NodeData data;
+            m_manager->GetNodeStatistics(homeId, nodeId, &data);
+            ZwaveTopology::LinkStatistics statistics;
+            statistics.sent = data.m_sentCnt;
+            statistics.failed = data.m_sentFailed;
+            statistics.retries = data.m_retries;
+            statistics.received = data.m_receivedCnt;
+            statistics.averageRtt = data.m_averageRequestRTT;
+            statistics.quality = data.m_quality;
+
+            m_topology.updateNode(homeId, nodeId, m_manager->IsNodeListeningDevice(homeId, nodeId), neighbors, statistics);
+        }
+
+        foreach (quint8 nodeId, m_topology.weakNodes(homeId)) {
+            ZwaveTopology::Node node = m_topology.node(homeId, nodeId);
+            // Sleeping nodes only take part in routing while awake, healing them gets stuck in the queue
+            if (!node.listening || m_healQueue.contains(qMakePair(homeId, nodeId))
+                    || m_commandQueue->contains(ZwaveCommandQueue::PriorityMaintenance, homeId, ValueID(homeId, nodeId).GetId()))
+                continue;
+            if (node.lastHeal >= 0 && now - node.lastHeal < healCooldown)
+                continue;
+
+            qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeId << "has a link score of" << node.score << ", scheduling a heal";
+            m_healQueue.append(qMakePair(homeId, nodeId));
+        }
+    }
+
+    if (!m_healQueue.isEmpty() && !m_healTimer->isActive()) {
+        m_healTimer->start();
+    }
+}
+
+void ZwaveManager::healNextNode()
+{
+    // One heal per controller and round. A heal floods the neighborhood of the node, it waits
+    // until its controller is idle, without holding back the heals of other controllers.
+    QSet<quint32> homeIds;
+    for (int i = 0; i < m_healQueue.count();) {
+        quint32 homeId = m_healQueue.at(i).first;
+        if (homeIds.contains(homeId)) {
+            i++;
+            continue;
+        }
+        homeIds.insert(homeId);
+
+        if (m_commandQueue->depth(homeId, ZwaveCommandQueue::PriorityInteractive) > 0
+                || m_commandQueue->depth(homeId, ZwaveCommandQueue::PriorityAutomation) > 0
+                || m_manager->GetSendQueueCount(homeId) > 0) {
+            i++;
+            continue;
+        }
+
+        quint8 nodeId = m_healQueue.takeAt(i).second;
+        queueCommand(ZwaveCommandQueue::PriorityMaintenance, CommandHealNode, ValueID(homeId, nodeId));
     }
 
+    if (m_healQueue.isEmpty()) {
+        m_healTimer->stop();
     }
 }
 
@@ -479,52 +1869,105 @@ void ZwaveManager::onNodeEvent(quint32 homeId, quint8 nodeId, NodeEvent event)
 {
     switch (event) {
     case NodeEventAdded: {
-
-        ZwaveNode *nodeInfo = new ZwaveNode(this);
-        nodeInfo->m_homeId = homeId;
-        nodeInfo->m_nodeId = nodeId;
-        nodeInfo->m_polled = false;
-        nodeInfo->m_name = QString::fromStdString(m_manager->GetNodeName(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-        nodeInfo->m_manufacturerName = QString::fromStdString(m_manager->GetNodeManufacturerName(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-        nodeInfo->m_productName = QString::fromStdString(m_manager->GetNodeProductName(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-        nodeInfo->m_deviceTypeString = QString::fromStdString(m_manager->GetNodeDeviceTypeString(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-        nodeInfo->m_deviceType = m_manager->GetNodeDeviceType(nodeInfo->m_homeId, nodeInfo->m_nodeId);
-        nodeInfo->m_manufacturerId =  QString::fromStdString(m_manager->GetNodeManufacturerId(nodeInfo->m_homeId, nodeInfo->m_nodeId));
-
-        m_nodes.append(nodeInfo);
+        // Metadata is fetched once the interview of the node is complete
+        ZwaveNode *nodeInfo = insertNode(homeId, nodeId);
+        nodeInfo->m_restored = false;
         emit nodeAdded(nodeInfo);
         break;
     }
     case NodeEventRemoved: {
-        foreach (ZwaveNode *nodeInfo, m_nodes) {
-            if (nodeInfo->homeId() == homeId && nodeInfo->nodeId() == nodeId) {
-                m_nodes.removeOne(nodeInfo);
-                emit nodeRemoved(nodeInfo->nodeId());
-                nodeInfo->deleteLater();
-            }
-        }
-        emit nodeRemoved(nodeId);
+        ZwaveNode *nodeInfo = getNode(homeId, nodeId);
+        if (!nodeInfo)
+            break;
+
+        m_nodeTables[homeId][nodeId] = nullptr;
+        m_nodes.removeOne(nodeInfo);
+        m_pollScheduler->removeNode(homeId, nodeId);
+        m_commandQueue->removeNode(homeId, nodeId);
+        m_topology.removeNode(homeId, nodeId);
+        m_healQueue.removeAll(qMakePair(homeId, nodeId));
+        dropWakeUpQueue(homeId, nodeId);
+        m_liveness->removeNode(homeId, nodeId);
+        emit nodeRemoved(homeId, nodeId);
+        nodeInfo->deleteLater();
+        break;
     }
     default:
         break;
     }
 }
 
+void ZwaveManager::fetchNodeMetadata(ZwaveNode *node)
+{
+    node->m_name = QString::fromStdString(m_manager->GetNodeName(node->m_homeId, node->m_nodeId));
+    node->m_manufacturerName = QString::fromStdString(m_manager->GetNodeManufacturerName(node->m_homeId, node->m_nodeId));
+    node->m_manufacturerId = QString::fromStdString(m_manager->GetNodeManufacturerId(node->m_homeId, node->m_nodeId));
+    node->m_productType = QString::fromStdString(m_manager->GetNodeProductType(node->m_homeId, node->m_nodeId));
+    node->m_productId = QString::fromStdString(m_manager->GetNodeProductId(node->m_homeId, node->m_nodeId));
+    node->m_productName = QString::fromStdString(m_manager->GetNodeProductName(node->m_homeId, node->m_nodeId));
+    node->m_deviceTypeString = QString::fromStdString(m_manager->GetNodeDeviceTypeString(node->m_homeId, node->m_nodeId));
+    node->m_deviceType = m_manager->GetNodeDeviceType(node->m_homeId, node->m_nodeId);
+    node->m_genericClass = m_manager->GetNodeGeneric(node->m_homeId, node->m_nodeId);
+    node->m_specificClass = m_manager->GetNodeSpecific(node->m_homeId, node->m_nodeId);
+    node->m_listening = m_manager->IsNodeListeningDevice(node->m_homeId, node->m_nodeId)
+            || m_manager->IsNodeFrequentListeningDevice(node->m_homeId, node->m_nodeId);
+    node->m_awake = m_manager->IsNodeAwake(node->m_homeId, node->m_nodeId);
+
+    // The controller itself never needs a ping
+    if (node->m_nodeId != m_manager->GetControllerNodeId(node->m_homeId)) {
+        m_liveness->addNode(node->m_homeId, node->m_nodeId, node->m_listening);
+        if (m_manager->IsNodeFailed(node->m_homeId, node->m_nodeId)) {
+            m_liveness->setAlive(node->m_homeId, node->m_nodeId, false);
+        }
+    }
+}
+
+ZwaveNode *ZwaveManager::insertNode(quint32 homeId, quint8 nodeId)
+{
+    QVector<ZwaveNode *> &table = m_nodeTables[homeId];
+    if (table.isEmpty())
+        table.fill(nullptr, 256);
+
+    ZwaveNode *nodeInfo = table.at(nodeId);
+    if (!nodeInfo) {
+        nodeInfo = new ZwaveNode(this);
+        nodeInfo->m_homeId = homeId;
+        nodeInfo->m_nodeId = nodeId;
+        nodeInfo->m_polled = false;
+        table[nodeId] = nodeInfo;
+        m_nodes.append(nodeInfo);
+    }
+    return nodeInfo;
+}
+
+void ZwaveManager::removeRestoredNodes(quint32 homeId)
+{
+    // Nodes from the snapshot the controller didn't announce anymore are gone
+    foreach (ZwaveNode *nodeInfo, m_nodes) {
+        if (nodeInfo->homeId() == homeId && nodeInfo->restored()) {
+            qCDebug(dcZwave()) << "ZwaveManager: Node" << nodeInfo->nodeId() << "from the snapshot does not exist any more";
+            onNodeEvent(homeId, nodeInfo->nodeId(), NodeEventRemoved);
+        }
+    }
+}
+
 void ZwaveManager::onValueEvent(quint32 homeId, quint8 nodeId,  quint64 valueId, ValueEvent event)
 {
-    Q_UNUSED(homeId)
-    Q_UNUSED(nodeId)
-    Q_UNUSED(valueId)
-    Q_UNUSED(event)
     ValueID vid(homeId, valueId);
-    /*if (!m_manager->IsValueSet(vid)) {
-        qCWarning(dcZwave()) << "ZWaveManager: valueId is not set" << valueId;
-        return;
-    }*/
+    ZwaveNode *nodeInfo = getNode(homeId, nodeId);
 
     switch (event) {
     case ValueEventAdded: {
         qCDebug(dcZwave()) << "ZwaveManager: Value added" << nodeId << valueId << m_manager->GetValueHelp(vid).c_str();
+        if (!nodeInfo) {
+            qCWarning(dcZwave()) << "ZwaveManager: Could not find node" << nodeId << "for new value";
+            break;
+        }
+        if (!nodeInfo->m_valueIdIndex.contains(valueId)) {
+            nodeInfo->m_valueIdIndex.insert(valueId);
+            nodeInfo->m_valueIds.append(vid);
+        }
+        nodeInfo->m_values[valueId].setUnitsId(unitsId(QString::fromStdString(m_manager->GetValueUnits(vid))));
         break;
     }
     case ValueEventChanged: {
@@ -533,28 +1976,101 @@ void ZwaveManager::onValueEvent(quint32 homeId, quint8 nodeId,  quint64 valueId,
     }
     case ValueEventRemoved: {
         qCDebug(dcZwave()) << "ZwaveManager: Value removed";
+        if (!nodeInfo)
+            break;
+
+        nodeInfo->m_valueIdIndex.remove(valueId);
+        nodeInfo->m_valueIds.removeAll(vid);
+        nodeInfo->m_values.remove(valueId);
+        m_pollScheduler->removeValue(homeId, valueId);
+        for (int role = 0; role < ZwaveNode::ValueRoleCount; role++) {
+            if (nodeInfo->m_roles[role] == valueId) {
+                nodeInfo->m_roles[role] = 0;
+            }
+        }
         break;
     }
     default:
         break;
     }
+}
+
+void ZwaveManager::buildValueRoles(ZwaveNode *node)
+{
+    // Runs once per interview, so the label lookups here never hit the action path
+    std::fill(node->m_roles, node->m_roles + ZwaveNode::ValueRoleCount, 0);
 
-    //        ZwaveNode *nodeInfo = manager->getNode(notification);
-    //        if (!nodeInfo) {
-    //            qCWarning(dcZwave()) << "Could not find node for new value";
-    //            break;
-    //        }
+    for (const ValueID &valueId : node->m_valueIds) {
+        ZwaveNode::ValueRole role = ZwaveNode::ValueRoleCount;
 
-    //        ValueID valueId = notification->GetValueID();
-    //        nodeInfo->m_valueIds.append(valueId);
+        switch (valueId.GetCommandClassId()) {
+        case 0x25: // COMMAND_CLASS_SWITCH_BINARY
+            if (valueId.GetType() == ValueID::ValueType_Bool && valueId.GetIndex() == 0)
+                role = ZwaveNode::ValueRoleSwitchBinary;
+            break;
+        case 0x26: // COMMAND_CLASS_SWITCH_MULTILEVEL
+            if (valueId.GetType() == ValueID::ValueType_Byte && valueId.GetIndex() == 0) {
+                role = ZwaveNode::ValueRoleSwitchMultilevel;
+            } else if (valueId.GetType() == ValueID::ValueType_Button) {
+                // Shutter devices relabel the Bright/Dim buttons, the label wins over the index
+                QString label = QString::fromStdString(m_manager->GetValueLabel(valueId));
+                if (label == "Up" || (label != "Down" && valueId.GetIndex() == 1)) {
+                    role = ZwaveNode::ValueRoleShutterUp;
+                } else if (label == "Down" || valueId.GetIndex() == 2) {
+                    role = ZwaveNode::ValueRoleShutterDown;
+                }
+            }
+            break;
+        case 0x30: // COMMAND_CLASS_SENSOR_BINARY
+            if (valueId.GetType() == ValueID::ValueType_Bool && valueId.GetIndex() == 0)
+                role = ZwaveNode::ValueRoleSensorBinary;
+            break;
+        case 0x32: // COMMAND_CLASS_METER
+            if (valueId.GetIndex() == 0) {
+                role = ZwaveNode::ValueRoleMeterEnergy;
+            } else if (valueId.GetIndex() == 2) {
+                role = ZwaveNode::ValueRoleMeterPower;
+            }
+            break;
+        case 0x84: // COMMAND_CLASS_WAKE_UP
+            if (valueId.GetIndex() == 0)
+                role = ZwaveNode::ValueRoleWakeUpInterval;
+            break;
+        default:
+            break;
+        }
 
-    //    ZwaveNode *nodeInfo = manager->getNode(notification);
-    //    if (!nodeInfo)
-    //        break;
+        // Multi channel devices report the same value per instance, the first one wins
+        if (role != ZwaveNode::ValueRoleCount && node->m_roles[role] == 0) {
+            node->m_roles[role] = valueId.GetId();
+        }
+    }
 
-    //    ValueID valueId = notification->GetValueID();
+    QStringList roles;
+    for (int role = 0; role < ZwaveNode::ValueRoleCount; role++) {
+        if (node->m_roles[role] != 0) {
+            roles.append(QMetaEnum::fromType<ZwaveNode::ValueRole>().valueToKey(role));
+        }
+    }
+    qCDebug(dcZwave()) << "ZwaveManager: Value roles for node" << node->nodeId() << roles;
+}
 
-    //    qCDebug(dcZwave()) << "Value changed:" << Manager::Get()->GetValueLabel(valueId).c_str() << ":" << manager->getValue(valueId);
+void ZwaveManager::schedulePolling(ZwaveNode *node)
+{
+    // Battery devices only listen while awake, polling them would just fill the queue
+    if (!m_manager->IsNodeListeningDevice(node->homeId(), node->nodeId()))
+        return;
 
+    static const ZwaveNode::ValueRole polledRoles[] = {
+        ZwaveNode::ValueRoleSwitchBinary,
+        ZwaveNode::ValueRoleSwitchMultilevel,
+        ZwaveNode::ValueRoleMeterPower,
+        ZwaveNode::ValueRoleMeterEnergy
+    };
 
+    for (ZwaveNode::ValueRole role : polledRoles) {
+        if (node->hasRole(role)) {
+            m_pollScheduler->addValue(node->homeId(), node->valueId(role).GetId());
+        }
+    }
 }
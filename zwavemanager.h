@@ -32,6 +32,11 @@
 #define ZWAVEMANAGER_H
 
 #include <QObject>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
 
 #include "openzwave/Options.h"
 #include "openzwave/Manager.h"
@@ -44,6 +49,15 @@
 #include "openzwave/value_classes/Value.h"
 
 #include "zwavenode.h"
+#include "zwavecommandqueue.h"
+#include "zwavecontroller.h"
+#include "zwaveliveness.h"
+#include "zwavemetrics.h"
+#include "zwavenotificationqueue.h"
+#include "zwavepollscheduler.h"
+#include "zwaveserialportindex.h"
+#include "zwavetopology.h"
+#include "zwavetrace.h"
 
 using namespace OpenZWave;
 
@@ -79,7 +93,19 @@ public:
     };
     Q_ENUM(NodeEvent)
 
-    explicit ZwaveManager(QObject *parent = 0);
+    enum Command {
+        CommandSetBool,
+        CommandSetByte,
+        CommandPressButton,
+        CommandReleaseButton,
+        CommandRefresh,
+        // Node commands, the value ID only carries the node ID
+        CommandHealNode,
+        CommandTestNode
+    };
+    Q_ENUM(Command)
+
+    explicit ZwaveManager(ZwaveSerialPortIndex *serialPortIndex, QObject *parent = 0);
     ~ZwaveManager();
 
     QString libraryVersion() const;
@@ -94,28 +120,187 @@ public:
     void hardResetController(quint32 homeId);
     void disable();
 
+    void dumpDiagnostics();
+
+    bool restoreSnapshot();
+    void saveSnapshot() const;
+
     void addNode(quint32 homeId); // start the inclusion process
     void removeNode(quint8 nodeId);
 
-    QList<ZwaveNode *> nodes() const;
-    ZwaveNode *getNode(const quint8 &nodeId);
+    const QList<ZwaveNode *> &nodes() const;
+    ZwaveNode *getNode(quint32 homeId, quint8 nodeId) const;
+    ZwaveNode *getNode(const quint8 &nodeId) const;
+
+    QString units(quint16 unitsId) const;
+
+    int valueCoalescingWindow() const;
+    void setValueCoalescingWindow(int msecs);
+    quint64 coalescedValueEvents() const;
+
+    ZwavePollScheduler *pollScheduler() const;
+    ZwaveCommandQueue *commandQueue() const;
+    const ZwaveTopology &topology() const;
+
+    // False once the node stopped answering or OpenZWave reported it dead
+    bool isNodeAlive(quint32 homeId, quint8 nodeId) const;
+
+    // Aggregates of the last metrics export
+    int notificationRate(quint32 homeId) const;
+    quint64 droppedNotifications(quint32 homeId) const;
+    int notificationQueueDepth(quint32 homeId) const;
+    int commandQueueDepth(quint32 homeId) const;
+    int actionLatency() const;
+
+    // Sends the same command to many values in one burst, returns the batch ID. The command
+    // IDs are filled in the order of valueIds, -1 for values which could not be queued.
+    int sendBatch(Command command, const QList<ValueID> &valueIds, const QVariant &value = QVariant(), ZwaveCommandQueue::Priority priority = ZwaveCommandQueue::PriorityInteractive, QList<int> *commandIds = nullptr);
 
     bool pressButton(const quint8 &nodeId, const ValueID &valueId);
     bool releaseButton(const quint8 &nodeId, const ValueID &valueId);
 
 private:
     Manager *m_manager = nullptr;
+    ZwaveSerialPortIndex *m_serialPortIndex = nullptr;
 
     bool m_initialized = false;
+    bool m_removingDriver = false;
 
     QList<ZwaveNode *> m_nodes;
+    // Direct-indexed node tables per home ID, node IDs are bounded to 232
+    QHash<quint32, QVector<ZwaveNode *>> m_nodeTables;
+
+    // One context per driver, the last slot collects notifications without a known controller.
+    // Slots are written on the Qt thread and read by the OpenZWave driver threads.
+    static const int maxControllers = 8;
+    QAtomicPointer<ZwaveController> m_controllers[maxControllers + 1];
+    QList<ZwaveController *> m_retiredControllers;
+    QElapsedTimer m_clock;
+
+    int findController(quint32 homeId, int notificationType);
+    int controllerIndex(const QString &driverPath) const;
+
+    // Value change coalescing, keyed by (homeId, valueId)
+    QTimer *m_coalescingTimer = nullptr;
+    QHash<QPair<quint32, quint64>, ZwaveNotificationRecord> m_pendingValueChanges;
+    quint64 m_coalescedValueEvents = 0;
+
+    ZwavePollScheduler *m_pollScheduler = nullptr;
+
+    // Outbound commands wait here until OpenZWave's own send queue has room for them
+    ZwaveCommandQueue *m_commandQueue = nullptr;
+    QTimer *m_dispatchTimer = nullptr;
+
+    struct Batch {
+        int count = 0;
+        int pending = 0;
+        qint64 start = 0;
+        bool complete = true;
+    };
+    QHash<int, Batch> m_batches;
+    int m_nextBatchId = 1;
+
+    // Commands waiting for the device to report the new value, keyed by (homeId, valueId)
+    struct Transaction {
+        int commandId = 0;
+        int batchId = 0;
+        Command command = CommandRefresh;
+        QVariant value;
+        qint64 queued = 0;
+        qint64 sent = -1;
+        bool deferred = false; // Held back for a sleeping node, doesn't time out before it is sent
+    };
+    QHash<QPair<quint32, quint64>, QList<Transaction>> m_transactions;
+    Transaction *findTransaction(quint32 homeId, quint64 valueId, int commandId);
+
+    struct TransactionStatistics {
+        quint64 count = 0;
+        quint64 failed = 0;
+        qint64 latencySum = 0;
+        qint64 latencyMax = 0;
+    };
+    TransactionStatistics m_transactionStatistics;
+
+    ZwaveMetrics m_metrics;
+    QTimer *m_metricsTimer = nullptr;
+    qint64 m_lastMetricsExport = 0;
+    QHash<quint32, quint64> m_notificationTotals;
+    QHash<quint32, int> m_notificationRates;
+    quint64 m_lastActionCount = 0;
+    qint64 m_lastActionLatencySum = 0;
+    int m_actionLatency = 0;
+
+    // Commands for sleeping nodes, merged while the node sleeps and handed over to OpenZWave
+    // right before it is due to wake up, keyed by (homeId, nodeId)
+    struct WakeUpCommand {
+        Command type = CommandRefresh;
+        quint64 valueId = 0;
+        QVariant value;
+        int commandId = 0;
+        bool handedOver = false; // Kept by OpenZWave for the next wake up
+    };
+    struct WakeUpQueue {
+        QList<WakeUpCommand> commands;
+        quint64 merged = 0;
+        quint64 flushed = 0;
+        quint32 windows = 0;
+        quint32 usedWindows = 0;
+        qint64 awakeSince = -1;
+        qint64 awakeTime = 0;
+        qint64 lastWakeUp = -1;
+        qint64 lastDeferred = -1;
+        int held() const;
+    };
+    QHash<QPair<quint32, quint8>, WakeUpQueue> m_wakeUpQueues;
+    QTimer *m_wakeUpTimer = nullptr;
+    void deferCommand(const ZwaveCommand &command);
+    void handOverCommands(quint32 homeId, quint8 nodeId);
+    void onNodeAwake(quint32 homeId, quint8 nodeId, bool awake);
+    void dropWakeUpQueue(quint32 homeId, quint8 nodeId);
+
+    ZwaveLiveness *m_liveness = nullptr;
+    void updateLiveness(const ZwaveNotificationRecord &record);
+
+    // Mesh graph sampled in the background, weak nodes are healed one at a time
+    ZwaveTopology m_topology;
+    QTimer *m_topologyTimer = nullptr;
+    QTimer *m_healTimer = nullptr;
+    QList<QPair<quint32, quint8>> m_healQueue;
+    void writeTopology() const;
+
+    // Notification trace recorded with NYMEA_ZWAVE_TRACE, the benchmark replays it
+    ZwaveTraceWriter *m_traceWriter = nullptr;
+
+    int queueCommand(ZwaveCommandQueue::Priority priority, Command command, const ValueID &valueId, const QVariant &value = QVariant(), int deadline = 0);
+    bool sendCommand(Command command, const ValueID &valueId, const QVariant &value);
+    static bool isNodeCommand(Command command);
+    void onCommandDropped(const ZwaveCommand &command);
+    void confirmTransaction(quint32 homeId, quint64 valueId, const ZwaveValue &value);
+    void finishTransaction(quint32 homeId, quint64 valueId, int commandId, bool success);
+    void expireTransactions(int batchId);
+    void finishBatch(int batchId);
 
     bool serialPortAvailable(const QString &driverPath) const;
-    ZwaveNode *getNode(const Notification *notification);
 
-    QVariant getValue(const ValueID &valueId);
+    // Units strings are interned, cached values only carry the index
+    QStringList m_units;
+    quint16 unitsId(const QString &units);
+
+    static ZwaveValue readValue(const ValueID &valueId);
+    void updateValue(const ZwaveNotificationRecord &record);
 
+    static QString notificationTypeName(quint8 type);
     static void onNotification(const Notification *notification, void* context);
+    void deliverNotification(const ZwaveNotificationRecord &record);
+    void processNotification(const ZwaveNotificationRecord &record);
+    QString snapshotFileName() const;
+    QString metricsFileName() const;
+    ZwaveNode *insertNode(quint32 homeId, quint8 nodeId);
+    void fetchNodeMetadata(ZwaveNode *node);
+    void removeRestoredNodes(quint32 homeId);
+
+    void buildValueRoles(ZwaveNode *node);
+    void schedulePolling(ZwaveNode *node);
     QString valueTypeToString(const ValueID &valueId);
 
 signals:
@@ -124,15 +309,30 @@ signals:
     void nodeEvent(quint32 homeId, quint8 nodeId, NodeEvent event);
 
     void initialized();
+    void snapshotRestored();
     void nodeDiscoveryFinished();
 
     void nodeAdded(ZwaveNode *node);
-    void nodeRemoved(const quint8 &nodeId);
+    void nodeRemoved(quint32 homeId, quint8 nodeId);
+    void nodeAliveChanged(quint32 homeId, quint8 nodeId, bool alive);
+
+    void batchFinished(int batchId, int count, qint64 duration, bool complete);
+    void metricsUpdated();
+    void transactionFinished(quint32 homeId, quint64 valueId, int commandId, bool success, qint64 latency);
+    // The node of the value is asleep, transactionFinished follows once it woke up
+    void transactionDeferred(quint32 homeId, quint64 valueId, int commandId);
 
 
 private slots:
+    void drainNotifications(int index);
+    void dispatchCommands();
+    void exportMetrics();
+    void flushValueChanges();
+    void handOverWakeUpCommands();
+    void healNextNode();
     void onNodeEvent(quint32 homeId, quint8 nodeId, NodeEvent event);
     void onValueEvent(quint32 homeId, quint8 nodeId,  quint64 valueId, ValueEvent event);
+    void updateTopology();
 };
 
 #endif // ZWAVEMANAGER_H
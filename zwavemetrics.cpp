@@ -0,0 +1,128 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavemetrics.h"
+#include "extern-plugininfo.h"
+
+#include <QSaveFile>
+
+const qint64 ZwaveMetrics::latencyBuckets[latencyBucketCount] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+ZwaveMetrics::ZwaveMetrics()
+{
+    for (int i = 0; i <= latencyBucketCount; i++) {
+        m_latencyCounts[i] = 0;
+    }
+}
+
+void ZwaveMetrics::recordActionLatency(qint64 msecs)
+{
+    int bucket = 0;
+    while (bucket < latencyBucketCount && msecs > latencyBuckets[bucket]) {
+        bucket++;
+    }
+    m_latencyCounts[bucket]++;
+    m_actionCount++;
+    m_actionLatencySum += msecs;
+}
+
+quint64 ZwaveMetrics::actionCount() const
+{
+    return m_actionCount;
+}
+
+qint64 ZwaveMetrics::actionLatencySum() const
+{
+    return m_actionLatencySum;
+}
+
+void ZwaveMetrics::clear()
+{
+    m_samples.clear();
+}
+
+void ZwaveMetrics::add(const QString &name, ZwaveMetrics::Type type, const QString &help, double value, const ZwaveMetrics::Labels &labels)
+{
+    Sample sample;
+    sample.name = name;
+    sample.type = type;
+    sample.help = help;
+    sample.value = value;
+    sample.labels = labels;
+    m_samples.append(sample);
+}
+
+QByteArray ZwaveMetrics::exposition() const
+{
+    QByteArray data;
+    QString lastName;
+    foreach (const Sample &sample, m_samples) {
+        // Samples of one metric are added in a row, HELP and TYPE are written once
+        if (sample.name != lastName) {
+            data += "# HELP " + sample.name.toUtf8() + ' ' + sample.help.toUtf8() + '\n';
+            data += "# TYPE " + sample.name.toUtf8() + (sample.type == TypeCounter ? " counter\n" : " gauge\n");
+            lastName = sample.name;
+        }
+
+        data += sample.name.toUtf8();
+        if (!sample.labels.isEmpty()) {
+            QStringList labels;
+            for (int i = 0; i < sample.labels.count(); i++) {
+                labels.append(sample.labels.at(i).first + "=\"" + sample.labels.at(i).second + '"');
+            }
+            data += '{' + labels.join(',').toUtf8() + '}';
+        }
+        data += ' ' + QByteArray::number(sample.value, 'g', 15) + '\n';
+    }
+
+    data += "# HELP zwave_action_latency_milliseconds Time from queueing an action until the device confirmed it\n";
+    data += "# TYPE zwave_action_latency_milliseconds histogram\n";
+    quint64 cumulative = 0;
+    for (int i = 0; i < latencyBucketCount; i++) {
+        cumulative += m_latencyCounts[i];
+        data += "zwave_action_latency_milliseconds_bucket{le=\"" + QByteArray::number(latencyBuckets[i]) + "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+    data += "zwave_action_latency_milliseconds_bucket{le=\"+Inf\"} " + QByteArray::number(m_actionCount) + '\n';
+    data += "zwave_action_latency_milliseconds_sum " + QByteArray::number(m_actionLatencySum) + '\n';
+    data += "zwave_action_latency_milliseconds_count " + QByteArray::number(m_actionCount) + '\n';
+    return data;
+}
+
+bool ZwaveMetrics::write(const QString &fileName) const
+{
+    // Scrapers must never see a half written file
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(dcZwave()) << "ZwaveMetrics: Could not open" << fileName << file.errorString();
+        return false;
+    }
+    file.write(exposition());
+    return file.commit();
+}
@@ -0,0 +1,80 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVEMETRICS_H
+#define ZWAVEMETRICS_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+// Collects the metrics of the Z-Wave stack for one export in the Prometheus text
+// format and keeps the histogram of action latencies between exports.
+class ZwaveMetrics
+{
+public:
+    enum Type {
+        TypeCounter,
+        TypeGauge
+    };
+
+    typedef QList<QPair<QString, QString>> Labels;
+
+    ZwaveMetrics();
+
+    void recordActionLatency(qint64 msecs);
+    quint64 actionCount() const;
+    qint64 actionLatencySum() const;
+
+    void clear();
+    void add(const QString &name, Type type, const QString &help, double value, const Labels &labels = Labels());
+    QByteArray exposition() const;
+    bool write(const QString &fileName) const;
+
+private:
+    static const int latencyBucketCount = 8;
+    static const qint64 latencyBuckets[latencyBucketCount];
+
+    quint64 m_latencyCounts[latencyBucketCount + 1];
+    quint64 m_actionCount = 0;
+    qint64 m_actionLatencySum = 0;
+
+    struct Sample {
+        QString name;
+        Type type;
+        QString help;
+        double value;
+        Labels labels;
+    };
+    QList<Sample> m_samples;
+};
+
+#endif // ZWAVEMETRICS_H
@@ -51,16 +51,82 @@ bool ZwaveNode::polled() const
     return m_polled;
 }
 
+bool ZwaveNode::restored() const
+{
+    return m_restored;
+}
+
+bool ZwaveNode::listening() const
+{
+    return m_listening;
+}
+
+bool ZwaveNode::awake() const
+{
+    return m_awake;
+}
+
 quint16 ZwaveNode::deviceType() const
 {
     return m_deviceType;
 }
 
-QList<ValueID> ZwaveNode::valueIds() const
+quint16 ZwaveNode::manufacturerId() const
+{
+    // OpenZWave reports the ids as "0x%.4x" strings
+    return m_manufacturerId.toUShort(nullptr, 16);
+}
+
+quint16 ZwaveNode::productType() const
+{
+    return m_productType.toUShort(nullptr, 16);
+}
+
+quint16 ZwaveNode::productId() const
+{
+    return m_productId.toUShort(nullptr, 16);
+}
+
+quint8 ZwaveNode::genericClass() const
+{
+    return m_genericClass;
+}
+
+quint8 ZwaveNode::specificClass() const
+{
+    return m_specificClass;
+}
+
+const QList<ValueID> &ZwaveNode::valueIds() const
 {
     return m_valueIds;
 }
 
+bool ZwaveNode::hasValue(quint64 valueId) const
+{
+    return m_valueIdIndex.contains(valueId);
+}
+
+bool ZwaveNode::hasRole(ZwaveNode::ValueRole role) const
+{
+    return m_roles[role] != 0;
+}
+
+ValueID ZwaveNode::valueId(ZwaveNode::ValueRole role) const
+{
+    return ValueID(m_homeId, m_roles[role]);
+}
+
+ZwaveValue ZwaveNode::value(quint64 valueId) const
+{
+    return m_values.value(valueId);
+}
+
+ZwaveValue ZwaveNode::value(ZwaveNode::ValueRole role) const
+{
+    return m_values.value(m_roles[role]);
+}
+
 QString ZwaveNode::name() const
 {
     return m_name;
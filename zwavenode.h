@@ -33,12 +33,15 @@
 
 #include <QObject>
 #include <QDebug>
+#include <QSet>
 
 #include "openzwave/Node.h"
 #include "openzwave/value_classes/ValueStore.h"
 #include "openzwave/value_classes/Value.h"
 #include "openzwave/value_classes/ValueBool.h"
 
+#include "zwavevalue.h"
+
 using namespace OpenZWave;
 
 class ZwaveNode : public QObject
@@ -47,14 +50,44 @@ class ZwaveNode : public QObject
 public:
     friend class ZwaveManager;
 
+    // Semantic meaning of a value, resolved once when the node interview is complete
+    enum ValueRole {
+        ValueRoleSwitchBinary,
+        ValueRoleSwitchMultilevel,
+        ValueRoleShutterUp,
+        ValueRoleShutterDown,
+        ValueRoleMeterEnergy,
+        ValueRoleMeterPower,
+        ValueRoleSensorBinary,
+        ValueRoleWakeUpInterval,
+        ValueRoleCount
+    };
+    Q_ENUM(ValueRole)
+
     explicit ZwaveNode(QObject *parent = 0);
 
     quint32 homeId() const;
     quint8 nodeId() const;
     bool polled() const;
+    bool restored() const;
+    bool listening() const; // Mains powered or frequently listening, reachable at any time
+    bool awake() const;
     quint16 deviceType() const;
 
-    QList<ValueID> valueIds() const;
+    quint16 manufacturerId() const;
+    quint16 productType() const;
+    quint16 productId() const;
+    quint8 genericClass() const;
+    quint8 specificClass() const;
+
+    const QList<ValueID> &valueIds() const;
+    bool hasValue(quint64 valueId) const;
+
+    bool hasRole(ValueRole role) const;
+    ValueID valueId(ValueRole role) const;
+
+    ZwaveValue value(quint64 valueId) const;
+    ZwaveValue value(ValueRole role) const;
 
     QString name() const;
     QString manufacturerName() const;
@@ -62,16 +95,26 @@ public:
     QString deviceTypeString() const;
 
 private:
-    quint32 m_homeId;
-    quint8 m_nodeId;
-    bool m_polled;
-    quint16 m_deviceType;
+    quint32 m_homeId = 0;
+    quint8 m_nodeId = 0;
+    bool m_polled = false;
+    bool m_restored = false; // Loaded from the snapshot and not confirmed by the controller yet
+    bool m_listening = true;
+    bool m_awake = false;
+    quint16 m_deviceType = 0;
+    quint8 m_genericClass = 0;
+    quint8 m_specificClass = 0;
 
     QList<ValueID> m_valueIds;
+    QSet<quint64> m_valueIdIndex;
+    quint64 m_roles[ValueRoleCount] = {};
+    QHash<quint64, ZwaveValue> m_values;
 
     QString m_name;
     QString m_manufacturerName;
     QString m_manufacturerId;
+    QString m_productType;
+    QString m_productId;
     QString m_productName;
     QString m_deviceTypeString;
 
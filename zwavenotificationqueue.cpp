@@ -0,0 +1,83 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavenotificationqueue.h"
+
+ZwaveNotificationQueue::ZwaveNotificationQueue(int capacity) :
+    m_head(0),
+    m_tail(0)
+{
+    // Round up to the next power of two so the index wraps with a mask
+    quint32 size = 2;
+    while (size < static_cast<quint32>(capacity))
+        size <<= 1;
+
+    m_buffer.resize(static_cast<int>(size));
+    m_mask = size - 1;
+}
+
+int ZwaveNotificationQueue::capacity() const
+{
+    return m_buffer.size();
+}
+
+int ZwaveNotificationQueue::count() const
+{
+    return static_cast<int>(m_tail.loadAcquire() - m_head.loadAcquire());
+}
+
+bool ZwaveNotificationQueue::isEmpty() const
+{
+    return count() == 0;
+}
+
+bool ZwaveNotificationQueue::push(const ZwaveNotificationRecord &record)
+{
+    const quint32 tail = m_tail.loadAcquire();
+    if (tail - m_head.loadAcquire() > m_mask)
+        return false;
+
+    m_buffer[static_cast<int>(tail & m_mask)] = record;
+    m_tail.storeRelease(tail + 1);
+    return true;
+}
+
+int ZwaveNotificationQueue::pop(ZwaveNotificationRecord *records, int maxCount)
+{
+    const quint32 head = m_head.loadAcquire();
+    const quint32 available = m_tail.loadAcquire() - head;
+    const quint32 count = qMin(available, static_cast<quint32>(maxCount));
+
+    for (quint32 i = 0; i < count; i++)
+        records[i] = m_buffer.at(static_cast<int>((head + i) & m_mask));
+
+    m_head.storeRelease(head + count);
+    return static_cast<int>(count);
+}
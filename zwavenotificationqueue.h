@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVENOTIFICATIONQUEUE_H
+#define ZWAVENOTIFICATIONQUEUE_H
+
+#include <QVector>
+#include <QAtomicInteger>
+
+#include "zwavevalue.h"
+
+// Compact copy of an OpenZWave notification. The Notification object is only
+// valid inside the watcher callback, so everything the Qt side needs has to be
+// copied out while we are still on the OpenZWave thread.
+struct ZwaveNotificationRecord
+{
+    // Not an OpenZWave type: notifications dropped on a full queue right before this
+    // record, the value ID holds their count
+    static const quint8 TypeDropped = 0xff;
+
+    qint64 timestamp = 0; // Monotonic enqueue time in ns
+    quint64 valueId = 0;
+    quint32 homeId = 0;
+    quint8 type = 0;
+    quint8 nodeId = 0;
+    quint8 code = 0; // Notification code, node event or controller state depending on the type
+    ZwaveValue value; // Only for value notifications, read while still on the OpenZWave thread
+};
+
+// Preallocated single-producer/single-consumer ring buffer. The producer is the
+// OpenZWave notification thread, the consumer is the Qt thread of the ZwaveManager.
+class ZwaveNotificationQueue
+{
+public:
+    explicit ZwaveNotificationQueue(int capacity = 4096);
+
+    int capacity() const;
+    int count() const;
+    bool isEmpty() const;
+
+    // Producer side
+    bool push(const ZwaveNotificationRecord &record);
+
+    // Consumer side
+    int pop(ZwaveNotificationRecord *records, int maxCount);
+
+private:
+    QVector<ZwaveNotificationRecord> m_buffer;
+    quint32 m_mask = 0;
+
+    alignas(64) QAtomicInteger<quint32> m_head; // Next slot to read, owned by the consumer
+    alignas(64) QAtomicInteger<quint32> m_tail; // Next slot to write, owned by the producer
+};
+
+#endif // ZWAVENOTIFICATIONQUEUE_H
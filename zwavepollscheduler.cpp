@@ -0,0 +1,228 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavepollscheduler.h"
+#include "extern-plugininfo.h"
+
+#include <algorithm>
+
+// A report within this time after a poll is considered the answer to it
+static const qint64 pollResponseTimeout = 10000;
+
+ZwavePollScheduler::ZwavePollScheduler(QObject *parent) :
+    QObject(parent)
+{
+    m_clock.start();
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(1000);
+    connect(m_timer, &QTimer::timeout, this, &ZwavePollScheduler::onTimeout);
+}
+
+void ZwavePollScheduler::addValue(quint32 homeId, quint64 valueId)
+{
+    QPair<quint32, quint64> key = qMakePair(homeId, valueId);
+    if (m_entries.contains(key))
+        return;
+
+    Entry entry;
+    entry.homeId = homeId;
+    entry.valueId = valueId;
+    entry.interval = baseInterval(entry.priority);
+    entry.nextPoll = m_clock.elapsed() + entry.interval;
+    m_entries.insert(key, entry);
+
+    if (!m_timer->isActive()) {
+        m_timer->start();
+    }
+}
+
+void ZwavePollScheduler::removeValue(quint32 homeId, quint64 valueId)
+{
+    m_entries.remove(qMakePair(homeId, valueId));
+    if (m_entries.isEmpty()) {
+        m_timer->stop();
+    }
+}
+
+void ZwavePollScheduler::removeNode(quint32 homeId, quint8 nodeId)
+{
+    QHash<QPair<quint32, quint64>, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        // The node ID lives in bits 24-31 of an OpenZWave value ID
+        if (it->homeId == homeId && static_cast<quint8>((it->valueId >> 24) & 0xff) == nodeId) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_entries.isEmpty()) {
+        m_timer->stop();
+    }
+}
+
+bool ZwavePollScheduler::contains(quint32 homeId, quint64 valueId) const
+{
+    return m_entries.contains(qMakePair(homeId, valueId));
+}
+
+void ZwavePollScheduler::setValueBound(quint32 homeId, quint64 valueId, bool bound)
+{
+    QHash<QPair<quint32, quint64>, Entry>::iterator it = m_entries.find(qMakePair(homeId, valueId));
+    if (it == m_entries.end())
+        return;
+
+    Priority priority = bound ? PriorityBound : PriorityUnbound;
+    if (it->priority == priority)
+        return;
+
+    it->priority = priority;
+    it->interval = baseInterval(priority);
+    it->nextPoll = qMin(it->nextPoll, m_clock.elapsed() + it->interval);
+}
+
+ZwavePollScheduler::Priority ZwavePollScheduler::priority(quint32 homeId, quint64 valueId) const
+{
+    return m_entries.value(qMakePair(homeId, valueId)).priority;
+}
+
+void ZwavePollScheduler::valueReported(quint32 homeId, quint64 valueId)
+{
+    QHash<QPair<quint32, quint64>, Entry>::iterator it = m_entries.find(qMakePair(homeId, valueId));
+    if (it == m_entries.end())
+        return;
+
+    qint64 now = m_clock.elapsed();
+    if (it->pollPending && now - it->lastPoll < pollResponseTimeout) {
+        it->pollPending = false;
+        return;
+    }
+
+    // The node reports on its own, no need to ask as often
+    it->pollPending = false;
+    it->reported = true;
+    it->interval = qMin(it->interval * 2, maxInterval(it->priority));
+    it->nextPoll = now + it->interval;
+}
+
+int ZwavePollScheduler::airtimeBudget() const
+{
+    return m_airtimeBudget;
+}
+
+void ZwavePollScheduler::setAirtimeBudget(int pollsPerMinute)
+{
+    qCDebug(dcZwave()) << "PollScheduler: Set airtime budget to" << pollsPerMinute << "polls per minute and controller";
+    m_airtimeBudget = qMax(1, pollsPerMinute);
+}
+
+int ZwavePollScheduler::pollInterval(quint32 homeId, quint64 valueId) const
+{
+    return m_entries.value(qMakePair(homeId, valueId)).interval;
+}
+
+double ZwavePollScheduler::effectivePollRate(quint32 homeId, quint64 valueId) const
+{
+    // Polls per hour
+    int interval = pollInterval(homeId, valueId);
+    if (interval <= 0)
+        return 0;
+
+    return 3600000.0 / interval;
+}
+
+quint64 ZwavePollScheduler::deferredPolls() const
+{
+    return m_deferredPolls;
+}
+
+int ZwavePollScheduler::baseInterval(ZwavePollScheduler::Priority priority)
+{
+    return priority == PriorityBound ? 30 * 1000 : 10 * 60 * 1000;
+}
+
+int ZwavePollScheduler::maxInterval(ZwavePollScheduler::Priority priority)
+{
+    return priority == PriorityBound ? 30 * 60 * 1000 : 60 * 60 * 1000;
+}
+
+void ZwavePollScheduler::onTimeout()
+{
+    qint64 now = m_clock.elapsed();
+
+    QHash<quint32, QList<Entry *>> due;
+    for (QHash<QPair<quint32, quint64>, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->nextPoll <= now) {
+            due[it->homeId].append(&(*it));
+        }
+    }
+
+    for (QHash<quint32, QList<Entry *>>::iterator it = due.begin(); it != due.end(); ++it) {
+        Budget &budget = m_budgets[it.key()];
+        if (budget.lastRefill == 0) {
+            budget.tokens = m_airtimeBudget;
+        } else {
+            budget.tokens = qMin<double>(m_airtimeBudget, budget.tokens + (now - budget.lastRefill) * m_airtimeBudget / 60000.0);
+        }
+        budget.lastRefill = now;
+
+        // Bound values first, the longest overdue first within a priority
+        QList<Entry *> &entries = it.value();
+        std::sort(entries.begin(), entries.end(), [](Entry *a, Entry *b) {
+            if (a->priority != b->priority)
+                return a->priority < b->priority;
+            return a->nextPoll < b->nextPoll;
+        });
+
+        foreach (Entry *entry, entries) {
+            if (budget.tokens < 1) {
+                // Out of budget, try again with the next tick. An entry waiting for several
+                // ticks is still one deferred poll.
+                if (!entry->deferred) {
+                    entry->deferred = true;
+                    m_deferredPolls++;
+                }
+                continue;
+            }
+            budget.tokens -= 1;
+
+            // Nobody reported since the last poll, slowly return to the base interval
+            if (entry->lastPoll >= 0 && !entry->reported) {
+                entry->interval = qMax(baseInterval(entry->priority), entry->interval / 2);
+            }
+            entry->reported = false;
+            entry->deferred = false;
+            entry->lastPoll = now;
+            entry->pollPending = true;
+            entry->nextPoll = now + entry->interval;
+            emit pollRequested(entry->homeId, entry->valueId);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVEPOLLSCHEDULER_H
+#define ZWAVEPOLLSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// Schedules value refreshes per value instead of using the global OpenZWave poll
+// interval. Values used by a thing state are polled more often, values of nodes
+// which report on their own are backed off and every controller has a budget of
+// polls per minute which is never exceeded.
+class ZwavePollScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        PriorityBound,
+        PriorityUnbound
+    };
+    Q_ENUM(Priority)
+
+    explicit ZwavePollScheduler(QObject *parent = nullptr);
+
+    void addValue(quint32 homeId, quint64 valueId);
+    void removeValue(quint32 homeId, quint64 valueId);
+    void removeNode(quint32 homeId, quint8 nodeId);
+    bool contains(quint32 homeId, quint64 valueId) const;
+
+    void setValueBound(quint32 homeId, quint64 valueId, bool bound);
+    Priority priority(quint32 homeId, quint64 valueId) const;
+
+    // Called for every report of a value, solicited or not
+    void valueReported(quint32 homeId, quint64 valueId);
+
+    int airtimeBudget() const;
+    void setAirtimeBudget(int pollsPerMinute);
+
+    int pollInterval(quint32 homeId, quint64 valueId) const;
+    double effectivePollRate(quint32 homeId, quint64 valueId) const;
+    quint64 deferredPolls() const;
+
+signals:
+    void pollRequested(quint32 homeId, quint64 valueId);
+
+private:
+    struct Entry {
+        quint32 homeId = 0;
+        quint64 valueId = 0;
+        Priority priority = PriorityUnbound;
+        int interval = 0;
+        qint64 nextPoll = 0;
+        qint64 lastPoll = -1;
+        bool pollPending = false;
+        bool reported = false; // Unsolicited report since the last poll
+        bool deferred = false; // Counted as deferred until it is polled
+    };
+
+    struct Budget {
+        double tokens = 0;
+        qint64 lastRefill = 0;
+    };
+
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_clock;
+    QHash<QPair<quint32, quint64>, Entry> m_entries;
+    QHash<quint32, Budget> m_budgets;
+    int m_airtimeBudget = 60;
+    quint64 m_deferredPolls = 0;
+
+    static int baseInterval(Priority priority);
+    static int maxInterval(Priority priority);
+
+private slots:
+    void onTimeout();
+};
+
+#endif // ZWAVEPOLLSCHEDULER_H
@@ -0,0 +1,140 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwaveserialportindex.h"
+#include "extern-plugininfo.h"
+
+#include <libudev.h>
+
+ZwaveSerialPortIndex::ZwaveSerialPortIndex(QObject *parent) :
+    QObject(parent)
+{
+    // Without the monitor the index still works, it just doesn't see hotplugged sticks
+    m_udev = udev_new();
+    if (m_udev) {
+        m_monitor = udev_monitor_new_from_netlink(m_udev, "udev");
+    }
+    if (m_monitor && udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "tty", nullptr) >= 0 && udev_monitor_enable_receiving(m_monitor) >= 0) {
+        m_notifier = new QSocketNotifier(udev_monitor_get_fd(m_monitor), QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &ZwaveSerialPortIndex::onUdevEvent);
+    } else {
+        qCWarning(dcZwave()) << "ZwaveSerialPortIndex: Could not monitor udev, serial ports added later won't be found";
+    }
+
+    rebuild();
+}
+
+ZwaveSerialPortIndex::~ZwaveSerialPortIndex()
+{
+    if (m_monitor)
+        udev_monitor_unref(m_monitor);
+
+    if (m_udev)
+        udev_unref(m_udev);
+}
+
+QList<ZwaveSerialPortIndex::Port> ZwaveSerialPortIndex::ports() const
+{
+    return m_ports.values();
+}
+
+bool ZwaveSerialPortIndex::contains(const QString &path) const
+{
+    return m_ports.contains(path);
+}
+
+ZwaveSerialPortIndex::Port ZwaveSerialPortIndex::port(const QString &path) const
+{
+    return m_ports.value(path);
+}
+
+QString ZwaveSerialPortIndex::pathByIdentifier(const QString &identifier) const
+{
+    return m_paths.value(identifier);
+}
+
+bool ZwaveSerialPortIndex::isBusy(const QString &path) const
+{
+    // Reads the lock file of the port, no enumeration involved
+    return m_infos.contains(path) && m_infos.value(path).isBusy();
+}
+
+void ZwaveSerialPortIndex::rebuild()
+{
+    QHash<QString, Port> ports;
+    QHash<QString, QString> paths;
+    QHash<QString, QSerialPortInfo> infos;
+    foreach (const QSerialPortInfo &info, QSerialPortInfo::availablePorts()) {
+        Port port;
+        port.path = info.systemLocation();
+        port.portName = info.portName();
+        port.serialNumber = info.serialNumber();
+        port.manufacturer = info.manufacturer();
+        port.description = info.description();
+        port.identifier = port.serialNumber.isEmpty() ? port.manufacturer + port.description : port.serialNumber;
+        ports.insert(port.path, port);
+        infos.insert(port.path, info);
+        if (!port.identifier.isEmpty() && !paths.contains(port.identifier)) {
+            paths.insert(port.identifier, port.path);
+        }
+    }
+
+    QHash<QString, Port> previous = m_ports;
+    m_ports = ports;
+    m_paths = paths;
+    m_infos = infos;
+
+    foreach (const QString &path, previous.keys()) {
+        if (!m_ports.contains(path)) {
+            qCDebug(dcZwave()) << "ZwaveSerialPortIndex: Serial port removed" << path;
+            emit portRemoved(path);
+        }
+    }
+    foreach (const QString &path, m_ports.keys()) {
+        if (!previous.contains(path)) {
+            qCDebug(dcZwave()) << "ZwaveSerialPortIndex: Serial port added" << path << m_ports.value(path).identifier;
+            emit portAdded(path);
+        }
+    }
+}
+
+void ZwaveSerialPortIndex::onUdevEvent()
+{
+    struct udev_device *device = udev_monitor_receive_device(m_monitor);
+    if (!device)
+        return;
+
+    // Only additions and removals change the list, the enumeration is only repeated for them
+    QString action = QString::fromLatin1(udev_device_get_action(device));
+    udev_device_unref(device);
+    if (action == "add" || action == "remove") {
+        rebuild();
+    }
+}
@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVESERIALPORTINDEX_H
+#define ZWAVESERIALPORTINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSocketNotifier>
+#include <QSerialPortInfo>
+
+struct udev;
+struct udev_monitor;
+
+// Index of the serial ports of the system. Enumerating the ports walks sysfs and
+// the udev database, so it is done once and again only when udev reports a tty
+// being added or removed.
+class ZwaveSerialPortIndex : public QObject
+{
+    Q_OBJECT
+public:
+    struct Port {
+        QString path;
+        QString portName;
+        QString serialNumber;
+        QString manufacturer;
+        QString description;
+        QString identifier; // Serial number, or manufacturer and description if there is none
+    };
+
+    explicit ZwaveSerialPortIndex(QObject *parent = nullptr);
+    ~ZwaveSerialPortIndex();
+
+    QList<Port> ports() const;
+    bool contains(const QString &path) const;
+    Port port(const QString &path) const;
+    QString pathByIdentifier(const QString &identifier) const;
+
+    // Looked up at the time of the call, a port gets opened and closed without udev noticing
+    bool isBusy(const QString &path) const;
+
+signals:
+    void portAdded(const QString &path);
+    void portRemoved(const QString &path);
+
+private:
+    struct udev *m_udev = nullptr;
+    struct udev_monitor *m_monitor = nullptr;
+    QSocketNotifier *m_notifier = nullptr;
+
+    QHash<QString, Port> m_ports;
+    QHash<QString, QString> m_paths;
+    QHash<QString, QSerialPortInfo> m_infos;
+
+    void rebuild();
+
+private slots:
+    void onUdevEvent();
+};
+
+#endif // ZWAVESERIALPORTINDEX_H
@@ -0,0 +1,606 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavesimulator.h"
+#include "extern-plugininfo.h"
+
+#include <QtEndian>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Serial API framing
+static const quint8 SOF = 0x01;
+static const quint8 ACK = 0x06;
+static const quint8 NAK = 0x15;
+static const quint8 CAN = 0x18;
+static const quint8 REQUEST = 0x00;
+static const quint8 RESPONSE = 0x01;
+
+// Serial API functions
+static const quint8 FUNC_ID_SERIAL_API_GET_INIT_DATA = 0x02;
+static const quint8 FUNC_ID_SERIAL_API_APPL_NODE_INFORMATION = 0x03;
+static const quint8 FUNC_ID_APPLICATION_COMMAND_HANDLER = 0x04;
+static const quint8 FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES = 0x05;
+static const quint8 FUNC_ID_SERIAL_API_SET_TIMEOUTS = 0x06;
+static const quint8 FUNC_ID_SERIAL_API_GET_CAPABILITIES = 0x07;
+static const quint8 FUNC_ID_SERIAL_API_SOFT_RESET = 0x08;
+static const quint8 FUNC_ID_ZW_SEND_DATA = 0x13;
+static const quint8 FUNC_ID_ZW_GET_VERSION = 0x15;
+static const quint8 FUNC_ID_ZW_GET_RANDOM = 0x1c;
+static const quint8 FUNC_ID_ZW_MEMORY_GET_ID = 0x20;
+static const quint8 FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO = 0x41;
+static const quint8 FUNC_ID_ZW_APPLICATION_UPDATE = 0x49;
+static const quint8 FUNC_ID_ZW_GET_SUC_NODE_ID = 0x56;
+static const quint8 FUNC_ID_ZW_REQUEST_NODE_INFO = 0x60;
+static const quint8 FUNC_ID_ZW_IS_FAILED_NODE_ID = 0x62;
+static const quint8 FUNC_ID_ZW_GET_ROUTING_INFO = 0x80;
+
+static const quint8 UPDATE_STATE_NODE_INFO_RECEIVED = 0x84;
+static const quint8 UPDATE_STATE_NODE_INFO_REQ_FAILED = 0x81;
+static const quint8 TRANSMIT_COMPLETE_OK = 0x00;
+static const quint8 TRANSMIT_COMPLETE_NO_ACK = 0x01;
+
+// Command classes
+static const quint8 COMMAND_CLASS_NO_OPERATION = 0x00;
+static const quint8 COMMAND_CLASS_BASIC = 0x20;
+static const quint8 COMMAND_CLASS_SWITCH_BINARY = 0x25;
+static const quint8 COMMAND_CLASS_SENSOR_BINARY = 0x30;
+static const quint8 COMMAND_CLASS_METER = 0x32;
+static const quint8 COMMAND_CLASS_MANUFACTURER_SPECIFIC = 0x72;
+static const quint8 COMMAND_CLASS_BATTERY = 0x80;
+static const quint8 COMMAND_CLASS_WAKE_UP = 0x84;
+static const quint8 COMMAND_CLASS_VERSION = 0x86;
+
+static const quint8 controllerNodeId = 1;
+static const int nodeBitmaskSize = 29;
+static const int awakeTime = 10000;
+
+ZwaveSimulator::Configuration ZwaveSimulator::parseConfiguration(const QString &configuration)
+{
+    Configuration result;
+    foreach (const QString &option, configuration.split(',', QString::SkipEmptyParts)) {
+        QString key = option.section('=', 0, 0).trimmed();
+        bool ok = false;
+        int value = option.section('=', 1).trimmed().toInt(&ok);
+        if (!ok || value < 0) {
+            qCWarning(dcZwave()) << "ZwaveSimulator: Ignoring invalid option" << option;
+            continue;
+        }
+
+        if (key == "nodes") {
+            result.nodes = qMin(value, 231);
+        } else if (key == "sleeping") {
+            result.sleeping = value;
+        } else if (key == "dead") {
+            result.dead = value;
+        } else if (key == "reportInterval") {
+            result.reportInterval = qMax(value, 1);
+        } else {
+            qCWarning(dcZwave()) << "ZwaveSimulator: Unknown option" << option;
+        }
+    }
+    return result;
+}
+
+ZwaveSimulator::ZwaveSimulator(const Configuration &configuration, QObject *parent) :
+    QObject(parent),
+    m_configuration(configuration)
+{
+    m_clock.start();
+
+    // Node 1 is the controller, the sleeping sensors come first, then the dead plugs
+    for (int i = 0; i < m_configuration.nodes; i++) {
+        Node node;
+        node.nodeId = static_cast<quint8>(controllerNodeId + 1 + i);
+        node.listening = i >= m_configuration.sleeping;
+        node.dead = node.listening && i < m_configuration.sleeping + m_configuration.dead;
+        node.power = node.listening ? 5 + i : 0;
+        m_nodes.append(node);
+    }
+
+    m_ackTimer = new QTimer(this);
+    m_ackTimer->setSingleShot(true);
+    m_ackTimer->setInterval(1500);
+    connect(m_ackTimer, &QTimer::timeout, this, [this]() {
+        qCDebug(dcZwave()) << "ZwaveSimulator: No ACK for the last frame";
+        m_awaitingAck = false;
+        sendNext();
+    });
+
+    m_reportTimer = new QTimer(this);
+    m_reportTimer->setInterval(m_configuration.reportInterval * 1000);
+    connect(m_reportTimer, &QTimer::timeout, this, &ZwaveSimulator::onReportTimeout);
+}
+
+ZwaveSimulator::~ZwaveSimulator()
+{
+    if (m_slave >= 0)
+        ::close(m_slave);
+
+    if (m_master >= 0)
+        ::close(m_master);
+}
+
+bool ZwaveSimulator::start()
+{
+    m_master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (m_master < 0 || ::grantpt(m_master) < 0 || ::unlockpt(m_master) < 0) {
+        qCWarning(dcZwave()) << "ZwaveSimulator: Could not create a pseudo terminal";
+        return false;
+    }
+    m_path = QString::fromLocal8Bit(::ptsname(m_master));
+
+    // Keep the slave open ourselves, otherwise reading the master fails while OpenZWave
+    // has not opened it yet or between reconnects. Raw mode keeps the binary frames intact.
+    m_slave = ::open(::ptsname(m_master), O_RDWR | O_NOCTTY);
+    if (m_slave < 0) {
+        qCWarning(dcZwave()) << "ZwaveSimulator: Could not open" << m_path;
+        return false;
+    }
+    struct termios attributes;
+    ::tcgetattr(m_slave, &attributes);
+    ::cfmakeraw(&attributes);
+    ::tcsetattr(m_slave, TCSANOW, &attributes);
+
+    m_notifier = new QSocketNotifier(m_master, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &ZwaveSimulator::onReadyRead);
+    m_reportTimer->start();
+
+    qCInfo(dcZwave()) << "ZwaveSimulator: Controller" << QString::number(m_configuration.homeId, 16) << "with" << m_nodes.count() << "nodes on" << m_path;
+    return true;
+}
+
+QString ZwaveSimulator::path() const
+{
+    return m_path;
+}
+
+QString ZwaveSimulator::serialNumber()
+{
+    return "zwave-simulator";
+}
+
+ZwaveSimulator::Node *ZwaveSimulator::node(quint8 nodeId)
+{
+    for (int i = 0; i < m_nodes.count(); i++) {
+        if (m_nodes.at(i).nodeId == nodeId) {
+            return &m_nodes[i];
+        }
+    }
+    return nullptr;
+}
+
+bool ZwaveSimulator::reachable(const Node *node) const
+{
+    if (!node || node->dead)
+        return false;
+
+    return node->listening || node->awakeUntil > m_clock.elapsed();
+}
+
+void ZwaveSimulator::writeBytes(const QByteArray &data)
+{
+    if (::write(m_master, data.constData(), data.size()) != data.size()) {
+        qCWarning(dcZwave()) << "ZwaveSimulator: Could not write to" << m_path;
+    }
+}
+
+void ZwaveSimulator::sendFrame(quint8 type, quint8 function, const QByteArray &data)
+{
+    QByteArray frame;
+    frame.append(static_cast<char>(SOF));
+    frame.append(static_cast<char>(data.size() + 3));
+    frame.append(static_cast<char>(type));
+    frame.append(static_cast<char>(function));
+    frame.append(data);
+
+    quint8 checksum = 0xff;
+    for (int i = 1; i < frame.size(); i++) {
+        checksum ^= static_cast<quint8>(frame.at(i));
+    }
+    frame.append(static_cast<char>(checksum));
+
+    m_outbound.enqueue(frame);
+    sendNext();
+}
+
+void ZwaveSimulator::sendNext()
+{
+    if (m_awaitingAck || m_outbound.isEmpty())
+        return;
+
+    writeBytes(m_outbound.dequeue());
+    m_awaitingAck = true;
+    m_ackTimer->start();
+}
+
+void ZwaveSimulator::sendApplicationCommand(quint8 nodeId, const QByteArray &command)
+{
+    QByteArray data;
+    data.append(static_cast<char>(0x00)); // Receive status
+    data.append(static_cast<char>(nodeId));
+    data.append(static_cast<char>(command.size()));
+    data.append(command);
+    sendFrame(REQUEST, FUNC_ID_APPLICATION_COMMAND_HANDLER, data);
+}
+
+void ZwaveSimulator::onReadyRead()
+{
+    char data[256];
+    ssize_t count = ::read(m_master, data, sizeof(data));
+    if (count <= 0)
+        return;
+
+    m_buffer.append(data, static_cast<int>(count));
+    while (!m_buffer.isEmpty()) {
+        quint8 byte = static_cast<quint8>(m_buffer.at(0));
+        if (byte == ACK || byte == NAK || byte == CAN) {
+            m_buffer.remove(0, 1);
+            if (byte != ACK) {
+                qCDebug(dcZwave()) << "ZwaveSimulator: Frame rejected with" << byte;
+            }
+            m_awaitingAck = false;
+            m_ackTimer->stop();
+            sendNext();
+            continue;
+        }
+
+        if (byte != SOF) {
+            m_buffer.remove(0, 1);
+            continue;
+        }
+
+        // SOF, length, type, function, data..., checksum. The length counts from the type on.
+        if (m_buffer.size() < 2)
+            return;
+
+        int length = static_cast<quint8>(m_buffer.at(1));
+        if (m_buffer.size() < length + 2)
+            return;
+
+        QByteArray frame = m_buffer.left(length + 2);
+        m_buffer.remove(0, length + 2);
+
+        quint8 checksum = 0xff;
+        for (int i = 1; i < frame.size() - 1; i++) {
+            checksum ^= static_cast<quint8>(frame.at(i));
+        }
+        if (length < 3 || checksum != static_cast<quint8>(frame.at(frame.size() - 1))) {
+            writeBytes(QByteArray(1, static_cast<char>(NAK)));
+            continue;
+        }
+
+        writeBytes(QByteArray(1, static_cast<char>(ACK)));
+        handleFrame(static_cast<quint8>(frame.at(2)), static_cast<quint8>(frame.at(3)), frame.mid(4, length - 3));
+    }
+}
+
+void ZwaveSimulator::handleFrame(quint8 type, quint8 function, const QByteArray &data)
+{
+    if (type != REQUEST)
+        return;
+
+    switch (function) {
+    case FUNC_ID_ZW_GET_VERSION: {
+        QByteArray response("Z-Wave 4.05");
+        response.append('\0');
+        response.append(static_cast<char>(0x01)); // Static controller
+        sendFrame(RESPONSE, function, response);
+        break;
+    }
+    case FUNC_ID_ZW_MEMORY_GET_ID: {
+        QByteArray response(4, 0);
+        qToBigEndian(m_configuration.homeId, reinterpret_cast<uchar *>(response.data()));
+        response.append(static_cast<char>(controllerNodeId));
+        sendFrame(RESPONSE, function, response);
+        break;
+    }
+    case FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES:
+        // SIS, real primary and SUC
+        sendFrame(RESPONSE, function, QByteArray(1, static_cast<char>(0x1c)));
+        break;
+    case FUNC_ID_SERIAL_API_GET_CAPABILITIES: {
+        QByteArray response;
+        response.append(static_cast<char>(0x01)).append(static_cast<char>(0x00)); // Application version
+        response.append(QByteArray(2, 0)); // Manufacturer
+        response.append(QByteArray(2, 0)); // Product type
+        response.append(QByteArray(2, 0)); // Product ID
+        QByteArray functions(32, 0);
+        const quint8 supported[] = {
+            FUNC_ID_SERIAL_API_GET_INIT_DATA, FUNC_ID_SERIAL_API_APPL_NODE_INFORMATION, FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES,
+            FUNC_ID_SERIAL_API_SET_TIMEOUTS, FUNC_ID_SERIAL_API_GET_CAPABILITIES, FUNC_ID_SERIAL_API_SOFT_RESET, FUNC_ID_ZW_SEND_DATA,
+            FUNC_ID_ZW_GET_VERSION, FUNC_ID_ZW_GET_RANDOM, FUNC_ID_ZW_MEMORY_GET_ID, FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO,
+            FUNC_ID_ZW_GET_SUC_NODE_ID, FUNC_ID_ZW_REQUEST_NODE_INFO, FUNC_ID_ZW_IS_FAILED_NODE_ID, FUNC_ID_ZW_GET_ROUTING_INFO
+        };
+        for (quint8 id : supported) {
+            functions[(id - 1) / 8] = static_cast<char>(functions.at((id - 1) / 8) | (1 << ((id - 1) % 8)));
+        }
+        response.append(functions);
+        sendFrame(RESPONSE, function, response);
+        break;
+    }
+    case FUNC_ID_ZW_GET_SUC_NODE_ID:
+        sendFrame(RESPONSE, function, QByteArray(1, static_cast<char>(controllerNodeId)));
+        break;
+    case FUNC_ID_SERIAL_API_GET_INIT_DATA: {
+        QByteArray response;
+        response.append(static_cast<char>(0x05)); // Serial API version
+        response.append(static_cast<char>(0x08)); // SIS
+        response.append(static_cast<char>(nodeBitmaskSize));
+        response.append(nodeBitmask());
+        response.append(static_cast<char>(0x05)).append(static_cast<char>(0x00)); // Chip type and version
+        sendFrame(RESPONSE, function, response);
+        break;
+    }
+    case FUNC_ID_SERIAL_API_SET_TIMEOUTS:
+        sendFrame(RESPONSE, function, QByteArray(2, 0x0f));
+        break;
+    case FUNC_ID_ZW_GET_RANDOM: {
+        QByteArray response;
+        response.append(static_cast<char>(0x01));
+        response.append(static_cast<char>(data.isEmpty() ? 0 : data.at(0)));
+        response.append(QByteArray(static_cast<quint8>(data.isEmpty() ? 0 : data.at(0)), static_cast<char>(0x5a)));
+        sendFrame(RESPONSE, function, response);
+        break;
+    }
+    case FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO: {
+        quint8 nodeId = data.isEmpty() ? 0 : static_cast<quint8>(data.at(0));
+        Node *virtualNode = node(nodeId);
+        QByteArray response(6, 0);
+        if (nodeId == controllerNodeId) {
+            response[0] = static_cast<char>(0x80 | 0x40 | 0x10 | 0x03);
+            response[3] = 0x02; // Static controller
+            response[4] = 0x02;
+            response[5] = 0x07;
+        } else if (virtualNode) {
+            response[0] = static_cast<char>((virtualNode->listening ? 0x80 : 0x00) | 0x40 | 0x10 | 0x03);
+            response[3] = 0x04; // Routing slave
+            response[4] = virtualNode->listening ? 0x10 : 0x20; // Binary switch or binary sensor
+            response[5] = 0x01;
+        }
+        sendFrame(RESPONSE, function, response);
+        break;
+    }
+    case FUNC_ID_ZW_REQUEST_NODE_INFO: {
+        quint8 nodeId = data.isEmpty() ? 0 : static_cast<quint8>(data.at(0));
+        Node *virtualNode = node(nodeId);
+        sendFrame(RESPONSE, function, QByteArray(1, static_cast<char>(0x01)));
+        if (!reachable(virtualNode)) {
+            QByteArray update;
+            update.append(static_cast<char>(UPDATE_STATE_NODE_INFO_REQ_FAILED)).append(QByteArray(2, 0));
+            sendFrame(REQUEST, FUNC_ID_ZW_APPLICATION_UPDATE, update);
+            break;
+        }
+
+        QByteArray commandClasses;
+        if (virtualNode->listening) {
+            commandClasses.append(static_cast<char>(COMMAND_CLASS_SWITCH_BINARY)).append(static_cast<char>(COMMAND_CLASS_METER));
+        } else {
+            commandClasses.append(static_cast<char>(COMMAND_CLASS_SENSOR_BINARY)).append(static_cast<char>(COMMAND_CLASS_WAKE_UP)).append(static_cast<char>(COMMAND_CLASS_BATTERY));
+        }
+        commandClasses.append(static_cast<char>(COMMAND_CLASS_MANUFACTURER_SPECIFIC)).append(static_cast<char>(COMMAND_CLASS_VERSION));
+
+        QByteArray update;
+        update.append(static_cast<char>(UPDATE_STATE_NODE_INFO_RECEIVED));
+        update.append(static_cast<char>(nodeId));
+        update.append(static_cast<char>(commandClasses.size() + 3));
+        update.append(static_cast<char>(0x04));
+        update.append(static_cast<char>(virtualNode->listening ? 0x10 : 0x20));
+        update.append(static_cast<char>(0x01));
+        update.append(commandClasses);
+        sendFrame(REQUEST, FUNC_ID_ZW_APPLICATION_UPDATE, update);
+        break;
+    }
+    case FUNC_ID_ZW_IS_FAILED_NODE_ID: {
+        Node *virtualNode = node(data.isEmpty() ? 0 : static_cast<quint8>(data.at(0)));
+        sendFrame(RESPONSE, function, QByteArray(1, static_cast<char>(virtualNode && virtualNode->dead ? 0x01 : 0x00)));
+        break;
+    }
+    case FUNC_ID_ZW_GET_ROUTING_INFO:
+        // Everybody is a neighbor of everybody
+        sendFrame(RESPONSE, function, nodeBitmask());
+        break;
+    case FUNC_ID_ZW_SEND_DATA:
+        handleSendData(data);
+        break;
+    case FUNC_ID_SERIAL_API_APPL_NODE_INFORMATION:
+    case FUNC_ID_SERIAL_API_SOFT_RESET:
+        // No response expected
+        break;
+    default:
+        qCDebug(dcZwave()) << "ZwaveSimulator: Unsupported function" << QString::number(function, 16);
+        break;
+    }
+}
+
+void ZwaveSimulator::handleSendData(const QByteArray &data)
+{
+    // Node ID, length, command, transmit options, callback ID
+    if (data.size() < 2)
+        return;
+
+    quint8 nodeId = static_cast<quint8>(data.at(0));
+    int length = static_cast<quint8>(data.at(1));
+    if (data.size() < length + 4)
+        return;
+
+    QByteArray command = data.mid(2, length);
+    quint8 callbackId = static_cast<quint8>(data.at(length + 3));
+    Node *virtualNode = node(nodeId);
+    bool acknowledged = reachable(virtualNode);
+
+    sendFrame(RESPONSE, FUNC_ID_ZW_SEND_DATA, QByteArray(1, static_cast<char>(0x01)));
+    if (callbackId != 0) {
+        QByteArray callback;
+        callback.append(static_cast<char>(callbackId));
+        callback.append(static_cast<char>(acknowledged ? TRANSMIT_COMPLETE_OK : TRANSMIT_COMPLETE_NO_ACK));
+        callback.append(QByteArray(2, 0)); // Transmit time
+        sendFrame(REQUEST, FUNC_ID_ZW_SEND_DATA, callback);
+    }
+
+    if (acknowledged && !command.isEmpty()) {
+        handleCommand(virtualNode, command);
+    }
+}
+
+void ZwaveSimulator::handleCommand(Node *node, const QByteArray &command)
+{
+    quint8 commandClass = static_cast<quint8>(command.at(0));
+    quint8 commandId = command.size() > 1 ? static_cast<quint8>(command.at(1)) : 0;
+    QByteArray report;
+    report.append(static_cast<char>(commandClass));
+
+    switch (commandClass) {
+    case COMMAND_CLASS_NO_OPERATION:
+        return;
+    case COMMAND_CLASS_BASIC:
+    case COMMAND_CLASS_SWITCH_BINARY:
+        if (commandId == 0x01 && command.size() > 2) {
+            // Set, the plug reports the new state on its own like most real ones do
+            node->on = command.at(2) != 0;
+        } else if (commandId != 0x02) {
+            return;
+        }
+        report.append(static_cast<char>(0x03)).append(static_cast<char>(node->on ? 0xff : 0x00));
+        break;
+    case COMMAND_CLASS_SENSOR_BINARY:
+        if (commandId != 0x02)
+            return;
+        report.append(static_cast<char>(0x03)).append(static_cast<char>(node->on ? 0xff : 0x00));
+        break;
+    case COMMAND_CLASS_METER:
+        if (commandId == 0x01) {
+            report = meterReport(node, command.size() > 2 ? (static_cast<quint8>(command.at(2)) >> 3) & 0x03 : 0);
+        } else if (commandId == 0x03) {
+            // Supported: electric meter with kWh and W
+            report.append(static_cast<char>(0x04)).append(static_cast<char>(0x01)).append(static_cast<char>(0x05));
+        } else {
+            return;
+        }
+        break;
+    case COMMAND_CLASS_MANUFACTURER_SPECIFIC:
+        if (commandId != 0x04)
+            return;
+        // Known products, generic binary switches and sensors are not classified
+        report.append(static_cast<char>(0x05));
+        report.append(QByteArray::fromHex(node->listening ? "010f06001000" : "010f08001001")); // Fibaro Wall Plug or Motion Sensor
+        break;
+    case COMMAND_CLASS_VERSION:
+        if (commandId == 0x11) {
+            report.append(QByteArray::fromHex("120304050100"));
+        } else if (commandId == 0x13 && command.size() > 2) {
+            report.append(static_cast<char>(0x14)).append(command.at(2));
+            report.append(static_cast<char>(static_cast<quint8>(command.at(2)) == COMMAND_CLASS_METER ? 2 : 1));
+        } else {
+            return;
+        }
+        break;
+    case COMMAND_CLASS_WAKE_UP:
+        if (commandId == 0x05) {
+            QByteArray interval(4, 0);
+            qToBigEndian<quint32>(static_cast<quint32>(m_configuration.reportInterval), reinterpret_cast<uchar *>(interval.data()));
+            report.append(static_cast<char>(0x06)).append(interval.mid(1, 3)).append(static_cast<char>(controllerNodeId));
+        } else if (commandId == 0x08) {
+            // No more information, back to sleep
+            node->awakeUntil = 0;
+            return;
+        } else {
+            return;
+        }
+        break;
+    case COMMAND_CLASS_BATTERY:
+        if (commandId != 0x02)
+            return;
+        report.append(static_cast<char>(0x03)).append(static_cast<char>(100));
+        break;
+    default:
+        return;
+    }
+
+    sendApplicationCommand(node->nodeId, report);
+}
+
+QByteArray ZwaveSimulator::nodeBitmask() const
+{
+    QByteArray bitmask(nodeBitmaskSize, 0);
+    bitmask[0] = static_cast<char>(1 << (controllerNodeId - 1));
+    foreach (const Node &node, m_nodes) {
+        int index = (node.nodeId - 1) / 8;
+        bitmask[index] = static_cast<char>(bitmask.at(index) | (1 << ((node.nodeId - 1) % 8)));
+    }
+    return bitmask;
+}
+
+QByteArray ZwaveSimulator::meterReport(const Node *node, quint8 scale) const
+{
+    // Electric meter, precision 1 for W and 2 for kWh, 4 byte values, no previous value
+    quint8 precision = scale == 2 ? 1 : 2;
+    double value = scale == 2 ? (node->on ? node->power : 0) : node->energy;
+    QByteArray data(4, 0);
+    qToBigEndian<qint32>(qRound(value * (precision == 1 ? 10 : 100)), reinterpret_cast<uchar *>(data.data()));
+
+    QByteArray report;
+    report.append(static_cast<char>(COMMAND_CLASS_METER));
+    report.append(static_cast<char>(0x02));
+    report.append(static_cast<char>(0x21));
+    report.append(static_cast<char>((precision << 5) | ((scale & 0x03) << 3) | 0x04));
+    report.append(data);
+    report.append(QByteArray(2, 0));
+    return report;
+}
+
+void ZwaveSimulator::onReportTimeout()
+{
+    for (int i = 0; i < m_nodes.count(); i++) {
+        Node &node = m_nodes[i];
+        if (node.dead)
+            continue;
+
+        if (node.listening) {
+            // Slightly varying load while switched on
+            if (node.on) {
+                node.power = qMax(1.0, node.power + (qrand() % 21 - 10) / 10.0);
+                node.energy += node.power * m_configuration.reportInterval / 3600000.0;
+            }
+            sendApplicationCommand(node.nodeId, meterReport(&node, 2));
+        } else {
+            // Battery powered sensors wake up, report their state and stay awake for a moment
+            node.on = !node.on;
+            node.awakeUntil = m_clock.elapsed() + awakeTime;
+            QByteArray report;
+            report.append(static_cast<char>(COMMAND_CLASS_SENSOR_BINARY)).append(static_cast<char>(0x03)).append(static_cast<char>(node.on ? 0xff : 0x00));
+            sendApplicationCommand(node.nodeId, report);
+            sendApplicationCommand(node.nodeId, QByteArray::fromHex("8407"));
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVESIMULATOR_H
+#define ZWAVESIMULATOR_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+
+// Z-Wave Serial API controller on a pseudo terminal. OpenZWave opens the slave
+// side like a USB stick and sees a virtual network of plugs and battery powered
+// binary sensors, some of them sleeping and some dead. Only the parts of the Serial
+// API OpenZWave needs for the startup, the interview and value reports are spoken.
+class ZwaveSimulator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Configuration {
+        int nodes = 8;
+        int sleeping = 1; // Battery powered binary sensors
+        int dead = 1; // Plugs which never acknowledge a frame
+        int reportInterval = 30; // Seconds between unsolicited reports
+        quint32 homeId = 0xc0ffee00;
+    };
+
+    // Parses "nodes=8,sleeping=1,dead=1,reportInterval=30", missing keys keep their default
+    static Configuration parseConfiguration(const QString &configuration);
+
+    explicit ZwaveSimulator(const Configuration &configuration, QObject *parent = nullptr);
+    ~ZwaveSimulator();
+
+    bool start();
+    QString path() const;
+    static QString serialNumber();
+
+private:
+    struct Node {
+        quint8 nodeId = 0;
+        bool listening = true;
+        bool dead = false;
+        bool on = false;
+        double power = 0;
+        double energy = 0;
+        qint64 awakeUntil = 0;
+    };
+
+    Configuration m_configuration;
+    QList<Node> m_nodes;
+    int m_master = -1;
+    int m_slave = -1;
+    QString m_path;
+    QSocketNotifier *m_notifier = nullptr;
+    QByteArray m_buffer;
+
+    // Frames to OpenZWave go out one at a time, each one has to be acknowledged
+    QQueue<QByteArray> m_outbound;
+    bool m_awaitingAck = false;
+    QTimer *m_ackTimer = nullptr;
+    QTimer *m_reportTimer = nullptr;
+    QElapsedTimer m_clock;
+
+    Node *node(quint8 nodeId);
+    bool reachable(const Node *node) const;
+
+    void writeBytes(const QByteArray &data);
+    void sendFrame(quint8 type, quint8 function, const QByteArray &data);
+    void sendNext();
+    void sendApplicationCommand(quint8 nodeId, const QByteArray &command);
+
+    void handleFrame(quint8 type, quint8 function, const QByteArray &data);
+    void handleSendData(const QByteArray &data);
+    void handleCommand(Node *node, const QByteArray &command);
+    QByteArray nodeBitmask() const;
+    QByteArray meterReport(const Node *node, quint8 scale) const;
+
+private slots:
+    void onReadyRead();
+    void onReportTimeout();
+};
+
+#endif // ZWAVESIMULATOR_H
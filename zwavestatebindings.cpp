@@ -0,0 +1,279 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavestatebindings.h"
+
+static QVariant convertBool(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(history)
+    return value.toBool();
+}
+
+static QVariant convertDouble(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(history)
+    return value.toDouble();
+}
+
+static QVariant convertInt(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(history)
+    return value.toInt();
+}
+
+static QVariant convertLastSeen(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(history)
+    // An invalid variant leaves the state alone
+    if (!value.toBool())
+        return QVariant();
+
+    return value.timestamp() / 1000;
+}
+
+static QVariant convertAverageShort(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(value)
+    return history->average(ZwaveValueHistory::WindowShort);
+}
+
+static QVariant convertAverageLong(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(value)
+    return history->average(ZwaveValueHistory::WindowLong);
+}
+
+static QVariant convertMinimumLong(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(value)
+    return history->minimum(ZwaveValueHistory::WindowLong);
+}
+
+static QVariant convertMaximumLong(const ZwaveValue &value, const ZwaveValueHistory *history)
+{
+    Q_UNUSED(value)
+    return history->maximum(ZwaveValueHistory::WindowLong);
+}
+
+ZwaveStateBindings::ZwaveStateBindings()
+{
+    m_clock.start();
+}
+
+ZwaveStateBindings::~ZwaveStateBindings()
+{
+    clear();
+}
+
+void ZwaveStateBindings::bind(Thing *thing, quint32 homeId, quint64 valueId, const StateTypeId &stateTypeId, ZwaveStateBindings::Conversion conversion)
+{
+    Binding binding;
+    binding.thing = thing;
+    binding.stateTypeId = stateTypeId;
+    binding.convert = converter(conversion);
+    binding.aggregate = conversion >= ConversionAverageShort;
+
+    QPair<quint32, quint64> key = qMakePair(homeId, valueId);
+    ValueBindings &valueBindings = m_bindings[key];
+    if (binding.aggregate && !valueBindings.history) {
+        History *&history = m_histories[key];
+        if (!history) {
+            history = new History();
+        }
+        valueBindings.history = history;
+    }
+
+    QVector<Binding> &bindings = valueBindings.bindings;
+    for (Binding &existing : bindings) {
+        if (existing.thing == thing && existing.stateTypeId == stateTypeId) {
+            existing = binding;
+            return;
+        }
+    }
+
+    bindings.append(binding);
+    m_thingValues[thing].append(key);
+}
+
+void ZwaveStateBindings::unbind(Thing *thing)
+{
+    m_pending.remove(thing);
+    foreach (const auto &key, m_thingValues.take(thing)) {
+        QHash<QPair<quint32, quint64>, ValueBindings>::iterator it = m_bindings.find(key);
+        if (it == m_bindings.end())
+            continue;
+
+        QVector<Binding> &bindings = it->bindings;
+        for (int i = bindings.count() - 1; i >= 0; i--) {
+            if (bindings.at(i).thing == thing) {
+                bindings.remove(i);
+            }
+        }
+        if (bindings.isEmpty()) {
+            m_bindings.erase(it);
+        }
+    }
+}
+
+void ZwaveStateBindings::clear()
+{
+    qDeleteAll(m_histories);
+    m_histories.clear();
+    m_bindings.clear();
+    m_thingValues.clear();
+    m_pending.clear();
+}
+
+bool ZwaveStateBindings::contains(quint32 homeId, quint64 valueId) const
+{
+    return m_bindings.contains(qMakePair(homeId, valueId));
+}
+
+int ZwaveStateBindings::count() const
+{
+    int count = 0;
+    foreach (const ValueBindings &valueBindings, m_bindings) {
+        count += valueBindings.bindings.count();
+    }
+    return count;
+}
+
+int ZwaveStateBindings::apply(quint32 homeId, quint64 valueId, const ZwaveValue &value)
+{
+    if (!value.isValid())
+        return 0;
+
+    QHash<QPair<quint32, quint64>, ValueBindings>::const_iterator it = m_bindings.constFind(qMakePair(homeId, valueId));
+    if (it == m_bindings.constEnd())
+        return 0;
+
+    // The report timestamp only tells reports apart, the windows run on the monotonic clock
+    History *history = it->history;
+    if (history && history->report != value.timestamp()) {
+        history->report = value.timestamp();
+        history->samples.addSample(m_clock.elapsed(), value.toDouble());
+    }
+
+    int queued = 0;
+    for (const Binding &binding : it->bindings) {
+        QVariant stateValue = binding.convert(value, history ? &history->samples : nullptr);
+        if (!stateValue.isValid())
+            continue;
+
+        queue(binding, stateValue);
+        queued++;
+    }
+    return queued;
+}
+
+bool ZwaveStateBindings::hasPending() const
+{
+    return !m_pending.isEmpty();
+}
+
+int ZwaveStateBindings::flush()
+{
+    QHash<Thing *, QVector<QPair<StateTypeId, QVariant>>> pending;
+    pending.swap(m_pending);
+
+    int applied = 0;
+    for (auto it = pending.constBegin(); it != pending.constEnd(); ++it) {
+        Thing *thing = it.key();
+        for (const QPair<StateTypeId, QVariant> &state : it.value()) {
+            // Every write ends up as a notification to all clients of the core
+            if (thing->stateValue(state.first) == state.second) {
+                m_statistics.suppressed++;
+                continue;
+            }
+            thing->setStateValue(state.first, state.second);
+            applied++;
+        }
+    }
+    m_statistics.applied += applied;
+    return applied;
+}
+
+int ZwaveStateBindings::expire()
+{
+    qint64 now = m_clock.elapsed();
+    int queued = 0;
+    for (auto it = m_bindings.constBegin(); it != m_bindings.constEnd(); ++it) {
+        if (!it->history || !it->history->samples.expire(now))
+            continue;
+
+        for (const Binding &binding : it->bindings) {
+            if (!binding.aggregate)
+                continue;
+
+            queue(binding, binding.convert(ZwaveValue(), &it->history->samples));
+            queued++;
+        }
+    }
+    return queued;
+}
+
+ZwaveStateBindings::Statistics ZwaveStateBindings::statistics() const
+{
+    return m_statistics;
+}
+
+void ZwaveStateBindings::queue(const ZwaveStateBindings::Binding &binding, const QVariant &stateValue)
+{
+    QVector<QPair<StateTypeId, QVariant>> &states = m_pending[binding.thing];
+    bool merged = false;
+    for (QPair<StateTypeId, QVariant> &state : states) {
+        if (state.first == binding.stateTypeId) {
+            state.second = stateValue;
+            merged = true;
+            break;
+        }
+    }
+    if (merged) {
+        m_statistics.merged++;
+    } else {
+        states.append(qMakePair(binding.stateTypeId, stateValue));
+    }
+    m_statistics.queued++;
+}
+
+ZwaveStateBindings::Converter ZwaveStateBindings::converter(ZwaveStateBindings::Conversion conversion)
+{
+    static const Converter converters[ConversionCount] = {
+        convertBool,
+        convertDouble,
+        convertInt,
+        convertLastSeen,
+        convertAverageShort,
+        convertAverageLong,
+        convertMinimumLong,
+        convertMaximumLong
+    };
+    return converters[conversion];
+}
@@ -0,0 +1,131 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVESTATEBINDINGS_H
+#define ZWAVESTATEBINDINGS_H
+
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "integrations/thing.h"
+
+#include "zwavevalue.h"
+#include "zwavevaluehistory.h"
+
+// Maps values of nodes to thing states. The conversion of a binding is picked when
+// it is created, applying a reported value is one hash lookup and a function call
+// per bound state, without asking the OpenZWave Manager for labels or types.
+//
+// Converted values are collected per thing until flush() is called, so a burst of
+// reports ends in one write per state and unchanged states are not written at all.
+//
+// Values with a bound aggregate keep a ZwaveValueHistory, fed once per report on a
+// monotonic clock. Histories outlive their bindings, a thing bound again after a new
+// interview or a reconnect continues where it was. expire() moves the windows on
+// while a value doesn't report.
+class ZwaveStateBindings
+{
+public:
+    struct Statistics {
+        quint64 queued = 0;
+        quint64 merged = 0;     // Replaced by a later value before the flush
+        quint64 suppressed = 0; // Value equal to the current state
+        quint64 applied = 0;
+    };
+
+    enum Conversion {
+        ConversionBool,
+        ConversionDouble,
+        ConversionInt,
+        ConversionLastSeen, // Timestamp of the report in seconds, only when the value is true
+        ConversionAverageShort,
+        ConversionAverageLong,
+        ConversionMinimumLong,
+        ConversionMaximumLong,
+        ConversionCount
+    };
+
+    ZwaveStateBindings();
+    ~ZwaveStateBindings();
+
+    void bind(Thing *thing, quint32 homeId, quint64 valueId, const StateTypeId &stateTypeId, Conversion conversion);
+    void unbind(Thing *thing);
+    void clear();
+
+    bool contains(quint32 homeId, quint64 valueId) const;
+    int count() const;
+
+    // Returns the number of states queued
+    int apply(quint32 homeId, quint64 valueId, const ZwaveValue &value);
+    bool hasPending() const;
+    int flush();
+
+    // Returns the number of aggregate states queued because their windows moved on
+    int expire();
+
+    Statistics statistics() const;
+
+private:
+    Q_DISABLE_COPY(ZwaveStateBindings)
+
+    typedef QVariant (*Converter)(const ZwaveValue &value, const ZwaveValueHistory *history);
+
+    struct Binding {
+        Thing *thing = nullptr;
+        StateTypeId stateTypeId;
+        Converter convert = nullptr;
+        bool aggregate = false;
+    };
+
+    struct History {
+        ZwaveValueHistory samples;
+        qint64 report = -1; // Timestamp of the last sampled report, a rebind applies it again
+    };
+
+    struct ValueBindings {
+        QVector<Binding> bindings;
+        History *history = nullptr;
+    };
+
+    static Converter converter(Conversion conversion);
+    void queue(const Binding &binding, const QVariant &stateValue);
+
+    QElapsedTimer m_clock;
+    QHash<QPair<quint32, quint64>, ValueBindings> m_bindings;
+    QHash<QPair<quint32, quint64>, History *> m_histories;
+    QHash<Thing *, QList<QPair<quint32, quint64>>> m_thingValues;
+
+    QHash<Thing *, QVector<QPair<StateTypeId, QVariant>>> m_pending;
+    Statistics m_statistics;
+};
+
+#endif // ZWAVESTATEBINDINGS_H
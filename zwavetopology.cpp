@@ -0,0 +1,211 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavetopology.h"
+
+#include <QJsonArray>
+
+#include <algorithm>
+
+void ZwaveTopology::updateNode(quint32 homeId, quint8 nodeId, bool listening, const QVector<quint8> &neighbors, const ZwaveTopology::LinkStatistics &statistics)
+{
+    Node &node = m_nodes[homeId][nodeId];
+    node.nodeId = nodeId;
+    node.listening = listening;
+    node.neighbors = neighbors;
+
+    // OpenZWave counts since the driver started, the score only looks at the recent traffic.
+    // Counters going backwards mean the driver was restarted.
+    if (statistics.sent < node.baseline.sent || statistics.failed < node.baseline.failed || statistics.retries < node.baseline.retries) {
+        node.baseline = LinkStatistics();
+    }
+    LinkStatistics delta = statistics;
+    delta.sent -= node.baseline.sent;
+    delta.failed -= node.baseline.failed;
+    delta.retries -= node.baseline.retries;
+    delta.received -= qMin(delta.received, node.baseline.received);
+    node.statistics = statistics;
+
+    // A quiet node collects its traffic over several samples until there is enough for a score
+    if (delta.sent >= static_cast<quint32>(minimumSamples)) {
+        node.score = score(delta, neighbors.count());
+        node.baseline = statistics;
+    }
+}
+
+void ZwaveTopology::removeNode(quint32 homeId, quint8 nodeId)
+{
+    QHash<quint32, QMap<quint8, Node>>::iterator it = m_nodes.find(homeId);
+    if (it == m_nodes.end())
+        return;
+
+    it->remove(nodeId);
+    for (Node &node : *it) {
+        node.neighbors.removeAll(nodeId);
+    }
+}
+
+void ZwaveTopology::clear(quint32 homeId)
+{
+    m_nodes.remove(homeId);
+}
+
+void ZwaveTopology::setHealed(quint32 homeId, quint8 nodeId, qint64 timestamp)
+{
+    QHash<quint32, QMap<quint8, Node>>::iterator it = m_nodes.find(homeId);
+    if (it == m_nodes.end() || !it->contains(nodeId))
+        return;
+
+    Node &node = (*it)[nodeId];
+    node.lastHeal = timestamp;
+    node.heals++;
+    // Judge the new routes on their own traffic
+    node.score = -1;
+    node.baseline = node.statistics;
+}
+
+QList<quint32> ZwaveTopology::homeIds() const
+{
+    return m_nodes.keys();
+}
+
+QList<quint8> ZwaveTopology::nodeIds(quint32 homeId) const
+{
+    return m_nodes.value(homeId).keys();
+}
+
+bool ZwaveTopology::contains(quint32 homeId, quint8 nodeId) const
+{
+    return m_nodes.value(homeId).contains(nodeId);
+}
+
+ZwaveTopology::Node ZwaveTopology::node(quint32 homeId, quint8 nodeId) const
+{
+    return m_nodes.value(homeId).value(nodeId);
+}
+
+QList<quint8> ZwaveTopology::weakNodes(quint32 homeId, int threshold) const
+{
+    QList<Node> weak;
+    foreach (const Node &node, m_nodes.value(homeId)) {
+        if (node.score >= 0 && node.score < threshold) {
+            weak.append(node);
+        }
+    }
+    std::sort(weak.begin(), weak.end(), [](const Node &a, const Node &b) {
+        return a.score < b.score;
+    });
+
+    QList<quint8> nodeIds;
+    foreach (const Node &node, weak) {
+        nodeIds.append(node.nodeId);
+    }
+    return nodeIds;
+}
+
+QByteArray ZwaveTopology::toDot(quint32 homeId, quint8 controllerNodeId) const
+{
+    QByteArray dot;
+    dot += "graph zwave_" + QByteArray::number(homeId, 16) + " {\n";
+    dot += "    " + QByteArray::number(controllerNodeId) + " [shape=doublecircle];\n";
+
+    const QMap<quint8, Node> nodes = m_nodes.value(homeId);
+    foreach (const Node &node, nodes) {
+        QByteArray label = QByteArray::number(node.nodeId) + "\\n" + (node.score < 0 ? QByteArray("?") : QByteArray::number(node.score));
+        dot += "    " + QByteArray::number(node.nodeId) + " [label=\"" + label + "\"";
+        if (!node.listening)
+            dot += ", style=dashed";
+        if (node.score >= 0 && node.score < healThreshold)
+            dot += ", color=red";
+        dot += "];\n";
+    }
+
+    // Neighbor lists are symmetric in theory, every link is drawn once
+    foreach (const Node &node, nodes) {
+        foreach (quint8 neighbor, node.neighbors) {
+            if (neighbor > node.nodeId || !nodes.contains(neighbor) || !nodes.value(neighbor).neighbors.contains(node.nodeId)) {
+                dot += "    " + QByteArray::number(node.nodeId) + " -- " + QByteArray::number(neighbor) + ";\n";
+            }
+        }
+    }
+    dot += "}\n";
+    return dot;
+}
+
+QJsonObject ZwaveTopology::toJson() const
+{
+    QJsonObject homes;
+    for (auto it = m_nodes.constBegin(); it != m_nodes.constEnd(); ++it) {
+        QJsonArray nodes;
+        foreach (const Node &node, it.value()) {
+            QJsonArray neighbors;
+            foreach (quint8 neighbor, node.neighbors) {
+                neighbors.append(neighbor);
+            }
+
+            QJsonObject statistics;
+            statistics.insert("sent", static_cast<qint64>(node.statistics.sent));
+            statistics.insert("failed", static_cast<qint64>(node.statistics.failed));
+            statistics.insert("retries", static_cast<qint64>(node.statistics.retries));
+            statistics.insert("received", static_cast<qint64>(node.statistics.received));
+            statistics.insert("averageRtt", static_cast<qint64>(node.statistics.averageRtt));
+            statistics.insert("quality", node.statistics.quality);
+
+            QJsonObject object;
+            object.insert("nodeId", node.nodeId);
+            object.insert("listening", node.listening);
+            object.insert("neighbors", neighbors);
+            object.insert("statistics", statistics);
+            object.insert("score", node.score);
+            object.insert("heals", node.heals);
+            nodes.append(object);
+        }
+        homes.insert(QString::number(it.key()), nodes);
+    }
+    return homes;
+}
+
+int ZwaveTopology::score(const ZwaveTopology::LinkStatistics &delta, int neighborCount)
+{
+    if (delta.sent == 0)
+        return -1;
+
+    double failures = static_cast<double>(delta.failed) / delta.sent;
+    double retries = qMin(1.0, static_cast<double>(delta.retries) / delta.sent);
+
+    double score = 100 - 60 * failures - 20 * retries;
+    if (delta.averageRtt > 1000)
+        score -= 10;
+    // A single neighbor is a single point of failure for the routes of the node
+    if (neighborCount < 2)
+        score -= 10;
+
+    return qBound(0, qRound(score), 100);
+}
@@ -0,0 +1,91 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVETOPOLOGY_H
+#define ZWAVETOPOLOGY_H
+
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QJsonObject>
+
+// In-memory graph of the mesh of every controller. Neighbor lists and the send
+// statistics OpenZWave keeps per node are sampled periodically, each node gets a
+// link score from 0 (unusable) to 100 from the traffic since the previous sample.
+class ZwaveTopology
+{
+public:
+    struct LinkStatistics {
+        quint32 sent = 0;
+        quint32 failed = 0;
+        quint32 retries = 0;
+        quint32 received = 0;
+        quint32 averageRtt = 0; // ms
+        quint8 quality = 0;
+    };
+
+    struct Node {
+        quint8 nodeId = 0;
+        bool listening = false;
+        QVector<quint8> neighbors;
+        LinkStatistics statistics;
+        LinkStatistics baseline; // Counters at the last score, the next one looks at the traffic since
+        int score = -1; // -1 until enough traffic was seen
+        qint64 lastHeal = -1;
+        int heals = 0;
+    };
+
+    // A score needs this many frames sent since the previous sample
+    static const int minimumSamples = 10;
+    static const int healThreshold = 60;
+
+    void updateNode(quint32 homeId, quint8 nodeId, bool listening, const QVector<quint8> &neighbors, const LinkStatistics &statistics);
+    void removeNode(quint32 homeId, quint8 nodeId);
+    void clear(quint32 homeId);
+    void setHealed(quint32 homeId, quint8 nodeId, qint64 timestamp);
+
+    QList<quint32> homeIds() const;
+    QList<quint8> nodeIds(quint32 homeId) const;
+    bool contains(quint32 homeId, quint8 nodeId) const;
+    Node node(quint32 homeId, quint8 nodeId) const;
+
+    // Scored nodes below the threshold, worst first
+    QList<quint8> weakNodes(quint32 homeId, int threshold = healThreshold) const;
+
+    QByteArray toDot(quint32 homeId, quint8 controllerNodeId) const;
+    QJsonObject toJson() const;
+
+    static int score(const LinkStatistics &delta, int neighborCount);
+
+private:
+    QHash<quint32, QMap<quint8, Node>> m_nodes;
+};
+
+#endif // ZWAVETOPOLOGY_H
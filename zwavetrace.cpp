@@ -0,0 +1,146 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavetrace.h"
+#include "extern-plugininfo.h"
+
+static const quint32 traceMagic = 0x5a575452; // "ZWTR"
+static const quint16 traceVersion = 1;
+
+static QDataStream &operator<<(QDataStream &stream, const ZwaveNotificationRecord &record)
+{
+    stream << record.timestamp << record.type << record.homeId << record.nodeId << record.code << record.valueId << record.value;
+    return stream;
+}
+
+static QDataStream &operator>>(QDataStream &stream, ZwaveNotificationRecord &record)
+{
+    stream >> record.timestamp >> record.type >> record.homeId >> record.nodeId >> record.code >> record.valueId >> record.value;
+    return stream;
+}
+
+ZwaveTraceWriter::ZwaveTraceWriter()
+{
+
+}
+
+ZwaveTraceWriter::~ZwaveTraceWriter()
+{
+    close();
+}
+
+bool ZwaveTraceWriter::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qCWarning(dcZwave()) << "ZwaveTrace: Could not open" << fileName << m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+    m_stream << traceMagic << traceVersion;
+    m_count = 0;
+    m_dropped = 0;
+    qCInfo(dcZwave()) << "ZwaveTrace: Recording notifications to" << fileName;
+    return true;
+}
+
+void ZwaveTraceWriter::close()
+{
+    if (!m_file.isOpen())
+        return;
+
+    m_stream.setDevice(nullptr);
+    m_file.close();
+    qCInfo(dcZwave()) << "ZwaveTrace: Recorded" << m_count << "notifications and" << m_dropped << "drops on a full queue to" << m_file.fileName();
+}
+
+bool ZwaveTraceWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+void ZwaveTraceWriter::write(const ZwaveNotificationRecord &record)
+{
+    // QFile buffers the writes, the disk is only touched every few kilobytes
+    m_stream << record;
+    if (record.type == ZwaveNotificationRecord::TypeDropped) {
+        m_dropped += record.valueId;
+    } else {
+        m_count++;
+    }
+}
+
+quint64 ZwaveTraceWriter::count() const
+{
+    return m_count;
+}
+
+ZwaveTraceReader::ZwaveTraceReader()
+{
+
+}
+
+bool ZwaveTraceReader::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QFile::ReadOnly)) {
+        qCWarning(dcZwave()) << "ZwaveTrace: Could not open" << fileName << m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    m_stream >> magic >> version;
+    if (magic != traceMagic || version != traceVersion) {
+        qCWarning(dcZwave()) << "ZwaveTrace:" << fileName << "is not a notification trace of version" << traceVersion;
+        m_stream.setDevice(nullptr);
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool ZwaveTraceReader::read(ZwaveNotificationRecord *record)
+{
+    if (!m_file.isOpen())
+        return false;
+
+    m_stream >> *record;
+    if (m_stream.status() != QDataStream::Ok) {
+        m_stream.setDevice(nullptr);
+        m_file.close();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVETRACE_H
+#define ZWAVETRACE_H
+
+#include <QFile>
+#include <QDataStream>
+
+#include "zwavenotificationqueue.h"
+
+// Binary log of notification records. A header with the magic "ZWTR" and the format
+// version is followed by one record per notification with its monotonic timestamp,
+// type, homeId, nodeId, code, 64 bit value ID and the decoded value. Notifications
+// dropped on a full queue leave a record of ZwaveNotificationRecord::TypeDropped.
+class ZwaveTraceWriter
+{
+public:
+    ZwaveTraceWriter();
+    ~ZwaveTraceWriter();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+
+    void write(const ZwaveNotificationRecord &record);
+    quint64 count() const;
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+    quint64 m_count = 0;
+    quint64 m_dropped = 0;
+};
+
+// Reads a trace back record by record, replaying it is up to the benchmark
+class ZwaveTraceReader
+{
+public:
+    ZwaveTraceReader();
+
+    bool open(const QString &fileName);
+    bool read(ZwaveNotificationRecord *record);
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+};
+
+#endif // ZWAVETRACE_H
@@ -31,8 +31,218 @@
 #include "zwavevalue.h"
 #include "extern-plugininfo.h"
 
-ZwaveValue::ZwaveValue(QObject *parent) : QObject(parent)
+#include <QDateTime>
+
+ZwaveValue::ZwaveValue()
+{
+    m_data.intValue = 0;
+}
+
+ZwaveValue ZwaveValue::fromBool(bool value)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeBool;
+    zwaveValue.m_data.boolValue = value;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue ZwaveValue::fromByte(quint8 value)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeByte;
+    zwaveValue.m_data.byteValue = value;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue ZwaveValue::fromDecimal(float value)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeDecimal;
+    zwaveValue.m_data.decimalValue = value;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue ZwaveValue::fromInt(qint32 value)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeInt;
+    zwaveValue.m_data.intValue = value;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue ZwaveValue::fromShort(qint16 value)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeShort;
+    zwaveValue.m_data.shortValue = value;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue ZwaveValue::fromListSelection(qint32 index)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeList;
+    zwaveValue.m_data.intValue = index;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue ZwaveValue::fromButton(bool pressed)
+{
+    ZwaveValue zwaveValue;
+    zwaveValue.m_type = TypeButton;
+    zwaveValue.m_data.boolValue = pressed;
+    zwaveValue.m_timestamp = QDateTime::currentMSecsSinceEpoch();
+    return zwaveValue;
+}
+
+ZwaveValue::Type ZwaveValue::type() const
+{
+    return m_type;
+}
+
+bool ZwaveValue::isValid() const
+{
+    return m_type != TypeInvalid;
+}
+
+qint64 ZwaveValue::timestamp() const
+{
+    return m_timestamp;
+}
+
+void ZwaveValue::setTimestamp(qint64 timestamp)
 {
+    m_timestamp = timestamp;
+}
+
+quint16 ZwaveValue::unitsId() const
+{
+    return m_unitsId;
+}
 
+void ZwaveValue::setUnitsId(quint16 unitsId)
+{
+    m_unitsId = unitsId;
+}
+
+bool ZwaveValue::toBool() const
+{
+    return toDouble() != 0;
 }
 
+quint8 ZwaveValue::toByte() const
+{
+    return static_cast<quint8>(toInt());
+}
+
+float ZwaveValue::toFloat() const
+{
+    return static_cast<float>(toDouble());
+}
+
+qint32 ZwaveValue::toInt() const
+{
+    switch (m_type) {
+    case TypeBool:
+    case TypeButton:
+        return m_data.boolValue ? 1 : 0;
+    case TypeByte:
+        return m_data.byteValue;
+    case TypeDecimal:
+        return qRound(m_data.decimalValue);
+    case TypeInt:
+    case TypeList:
+        return m_data.intValue;
+    case TypeShort:
+        return m_data.shortValue;
+    default:
+        return 0;
+    }
+}
+
+double ZwaveValue::toDouble() const
+{
+    if (m_type == TypeDecimal)
+        return m_data.decimalValue;
+
+    return toInt();
+}
+
+QVariant ZwaveValue::toVariant() const
+{
+    switch (m_type) {
+    case TypeBool:
+    case TypeButton:
+        return QVariant(m_data.boolValue);
+    case TypeByte:
+        return QVariant(m_data.byteValue);
+    case TypeDecimal:
+        return QVariant(m_data.decimalValue);
+    case TypeInt:
+    case TypeList:
+        return QVariant(m_data.intValue);
+    case TypeShort:
+        return QVariant(m_data.shortValue);
+    default:
+        return QVariant();
+    }
+}
+
+QDebug operator<<(QDebug debug, const ZwaveValue &value)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "ZwaveValue(" << value.toVariant() << ", " << QDateTime::fromMSecsSinceEpoch(value.timestamp()).toString("hh:mm:ss.zzz") << ")";
+    return debug;
+}
+
+QDataStream &operator<<(QDataStream &stream, const ZwaveValue &value)
+{
+    stream << static_cast<quint8>(value.m_type) << value.m_timestamp << value.m_unitsId;
+    if (value.m_type == ZwaveValue::TypeDecimal) {
+        stream << value.m_data.decimalValue;
+    } else {
+        stream << value.toInt();
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, ZwaveValue &value)
+{
+    quint8 type = 0;
+    stream >> type >> value.m_timestamp >> value.m_unitsId;
+    value.m_type = static_cast<ZwaveValue::Type>(type);
+    switch (value.m_type) {
+    case ZwaveValue::TypeDecimal:
+        stream >> value.m_data.decimalValue;
+        break;
+    case ZwaveValue::TypeBool:
+    case ZwaveValue::TypeButton: {
+        qint32 intValue = 0;
+        stream >> intValue;
+        value.m_data.boolValue = intValue != 0;
+        break;
+    }
+    case ZwaveValue::TypeByte: {
+        qint32 intValue = 0;
+        stream >> intValue;
+        value.m_data.byteValue = static_cast<quint8>(intValue);
+        break;
+    }
+    case ZwaveValue::TypeShort: {
+        qint32 intValue = 0;
+        stream >> intValue;
+        value.m_data.shortValue = static_cast<qint16>(intValue);
+        break;
+    }
+    default:
+        stream >> value.m_data.intValue;
+        break;
+    }
+    return stream;
+}
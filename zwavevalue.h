@@ -31,22 +31,72 @@
 #ifndef ZWAVEVALUE_H
 #define ZWAVEVALUE_H
 
-#include <QObject>
+#include <QDebug>
+#include <QVariant>
+#include <QDataStream>
 
-#include "openzwave/Node.h"
-#include "openzwave/value_classes/ValueStore.h"
-#include "openzwave/value_classes/Value.h"
-#include "openzwave/value_classes/ValueBool.h"
-
-class ZwaveValue : public QObject
+// Compact snapshot of a value as it was reported in the last notification. It is
+// filled on the OpenZWave thread and copied around by value, so reading it never
+// has to go back into the OpenZWave Manager and its locks.
+class ZwaveValue
 {
-    Q_OBJECT
 public:
-    explicit ZwaveValue(QObject *parent = 0);
+    enum Type : quint8 {
+        TypeInvalid,
+        TypeBool,
+        TypeByte,
+        TypeDecimal,
+        TypeInt,
+        TypeShort,
+        TypeList,
+        TypeButton
+    };
+
+    ZwaveValue();
+
+    static ZwaveValue fromBool(bool value);
+    static ZwaveValue fromByte(quint8 value);
+    static ZwaveValue fromDecimal(float value);
+    static ZwaveValue fromInt(qint32 value);
+    static ZwaveValue fromShort(qint16 value);
+    static ZwaveValue fromListSelection(qint32 index);
+    static ZwaveValue fromButton(bool pressed);
+
+    Type type() const;
+    bool isValid() const;
+
+    qint64 timestamp() const;
+    void setTimestamp(qint64 timestamp);
 
-signals:
+    quint16 unitsId() const;
+    void setUnitsId(quint16 unitsId);
 
-public slots:
+    bool toBool() const;
+    quint8 toByte() const;
+    float toFloat() const;
+    qint32 toInt() const;
+    double toDouble() const;
+    QVariant toVariant() const;
+
+private:
+    friend QDataStream &operator<<(QDataStream &stream, const ZwaveValue &value);
+    friend QDataStream &operator>>(QDataStream &stream, ZwaveValue &value);
+
+    union {
+        bool boolValue;
+        quint8 byteValue;
+        float decimalValue;
+        qint32 intValue;
+        qint16 shortValue;
+    } m_data;
+
+    qint64 m_timestamp = 0; // ms since epoch
+    quint16 m_unitsId = 0;
+    Type m_type = TypeInvalid;
 };
 
+QDebug operator<<(QDebug debug, const ZwaveValue &value);
+QDataStream &operator<<(QDataStream &stream, const ZwaveValue &value);
+QDataStream &operator>>(QDataStream &stream, ZwaveValue &value);
+
 #endif // ZWAVEVALUE_H
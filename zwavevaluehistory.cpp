@@ -0,0 +1,223 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "zwavevaluehistory.h"
+
+qint64 ZwaveValueHistory::windowLength(ZwaveValueHistory::Window window)
+{
+    switch (window) {
+    case WindowShort:
+        return 60 * 1000;
+    case WindowLong:
+        return 15 * 60 * 1000;
+    default:
+        return 0;
+    }
+}
+
+qint64 ZwaveValueHistory::resolution()
+{
+    // All slots but the newest one and the one holding at the start span the longest window
+    return windowLength(WindowLong) / (capacity - 2);
+}
+
+void ZwaveValueHistory::addSample(qint64 timestamp, double value)
+{
+    if (m_next > 0) {
+        Slot &newest = m_slots[(m_next - 1) & mask];
+        timestamp = qMax(timestamp, newest.end);
+
+        // Too close to the start of the newest slot, the sample goes into that slot
+        if (timestamp - newest.start < resolution()) {
+            newest.area += newest.value * (timestamp - newest.end);
+            newest.end = timestamp;
+            newest.value = value;
+            newest.minimum = qMin(newest.minimum, value);
+            newest.maximum = qMax(newest.maximum, value);
+            m_now = qMax(m_now, timestamp);
+
+            // The newest slot is always last in the queues, it goes in again with its new extremes
+            quint16 slot = static_cast<quint16>((m_next - 1) & mask);
+            for (int window = 0; window < WindowCount; window++) {
+                WindowState &state = m_windows[window];
+                state.minimumTail--;
+                state.maximumTail--;
+                insert(state, slot);
+                trim(state, m_now - windowLength(static_cast<Window>(window)));
+            }
+            return;
+        }
+
+        // The newest slot is complete now, its integral runs up to the new sample
+        for (int window = 0; window < WindowCount; window++) {
+            m_windows[window].area += area(m_next - 1, timestamp);
+        }
+    }
+
+    quint64 sequence = m_next;
+    quint16 slot = static_cast<quint16>(sequence & mask);
+    for (int window = 0; window < WindowCount; window++) {
+        WindowState &state = m_windows[window];
+        // The slot is about to be overwritten, its samples leave in any case
+        while (state.first + capacity <= sequence) {
+            evict(state);
+        }
+    }
+
+    m_slots[slot].start = timestamp;
+    m_slots[slot].end = timestamp;
+    m_slots[slot].value = value;
+    m_slots[slot].minimum = value;
+    m_slots[slot].maximum = value;
+    m_slots[slot].area = 0;
+    m_next++;
+    m_now = qMax(m_now, timestamp);
+
+    for (int window = 0; window < WindowCount; window++) {
+        WindowState &state = m_windows[window];
+        insert(state, slot);
+        trim(state, m_now - windowLength(static_cast<Window>(window)));
+    }
+}
+
+bool ZwaveValueHistory::expire(qint64 now)
+{
+    if (m_next == 0 || now <= m_now)
+        return false;
+
+    m_now = now;
+    for (int window = 0; window < WindowCount; window++) {
+        trim(m_windows[window], now - windowLength(static_cast<Window>(window)));
+    }
+    return true;
+}
+
+int ZwaveValueHistory::count() const
+{
+    return static_cast<int>(qMin<quint64>(m_next, capacity));
+}
+
+int ZwaveValueHistory::count(ZwaveValueHistory::Window window) const
+{
+    return static_cast<int>(m_next - m_windows[window].first);
+}
+
+double ZwaveValueHistory::average(ZwaveValueHistory::Window window) const
+{
+    if (m_next == 0)
+        return 0;
+
+    // Exact for a value that doesn't change, a state written on every expire() would differ in the last bit
+    if (minimum(window) == maximum(window))
+        return minimum(window);
+
+    const WindowState &state = m_windows[window];
+    const Slot &first = m_slots[state.first & mask];
+    qint64 start = qMax(first.start, m_now - windowLength(window));
+    qint64 duration = m_now - start;
+    if (duration <= 0)
+        return m_slots[(m_next - 1) & mask].value;
+
+    // The part of the first slot before the window start is cut off
+    double cut = 0;
+    if (start > first.start) {
+        if (start >= first.end) {
+            cut = area(state.first, start);
+        } else {
+            cut = first.area * (start - first.start) / (first.end - first.start);
+        }
+    }
+    return (state.area + area(m_next - 1, m_now) - cut) / duration;
+}
+
+double ZwaveValueHistory::minimum(ZwaveValueHistory::Window window) const
+{
+    const WindowState &state = m_windows[window];
+    if (state.minimumHead == state.minimumTail)
+        return 0;
+
+    return m_slots[state.minimumSlots[state.minimumHead & mask]].minimum;
+}
+
+double ZwaveValueHistory::maximum(ZwaveValueHistory::Window window) const
+{
+    const WindowState &state = m_windows[window];
+    if (state.maximumHead == state.maximumTail)
+        return 0;
+
+    return m_slots[state.maximumSlots[state.maximumHead & mask]].maximum;
+}
+
+double ZwaveValueHistory::area(quint64 sequence, qint64 until) const
+{
+    const Slot &slot = m_slots[sequence & mask];
+    return slot.area + slot.value * (until - slot.end);
+}
+
+void ZwaveValueHistory::insert(ZwaveValueHistory::WindowState &state, quint16 slot)
+{
+    const Slot &inserted = m_slots[slot];
+    while (state.minimumTail != state.minimumHead && m_slots[state.minimumSlots[(state.minimumTail - 1) & mask]].minimum >= inserted.minimum) {
+        state.minimumTail--;
+    }
+    state.minimumSlots[state.minimumTail++ & mask] = slot;
+
+    while (state.maximumTail != state.maximumHead && m_slots[state.maximumSlots[(state.maximumTail - 1) & mask]].maximum <= inserted.maximum) {
+        state.maximumTail--;
+    }
+    state.maximumSlots[state.maximumTail++ & mask] = slot;
+}
+
+void ZwaveValueHistory::trim(ZwaveValueHistory::WindowState &state, qint64 start)
+{
+    // A slot stays as long as it still holds at the window start, the newest one stays in any case
+    while (state.first + 1 < m_next && m_slots[(state.first + 1) & mask].start <= start) {
+        evict(state);
+    }
+}
+
+void ZwaveValueHistory::evict(ZwaveValueHistory::WindowState &state)
+{
+    quint16 slot = static_cast<quint16>(state.first & mask);
+    if (state.minimumHead != state.minimumTail && state.minimumSlots[state.minimumHead & mask] == slot) {
+        state.minimumHead++;
+    }
+    if (state.maximumHead != state.maximumTail && state.maximumSlots[state.maximumHead & mask] == slot) {
+        state.maximumHead++;
+    }
+
+    // Start over from zero instead of carrying the rounding error of all past slots
+    if (state.first + 2 >= m_next) {
+        state.area = 0;
+    } else {
+        state.area -= area(state.first, m_slots[(state.first + 1) & mask].start);
+    }
+    state.first++;
+}
@@ -0,0 +1,109 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ZWAVEVALUEHISTORY_H
+#define ZWAVEVALUEHISTORY_H
+
+#include <QtGlobal>
+
+// Fixed size history of the samples of one value with sliding window aggregates.
+// A value holds until the next report, so averages are weighted by the time each
+// value held. Every slot keeps the integral of value x hold time of its samples and
+// the windows keep the integral over their slots. Together with monotonic min/max
+// queues, adding a sample and reading an aggregate are O(1) and nothing is allocated
+// after construction. Windows end at the latest sample, or at the time passed to
+// expire() when reports stop. They start with the slot holding at their start.
+// Samples less than resolution() after the first one of the newest slot share that
+// slot, so the slots always cover the longest window whatever the report rate. The
+// minimum and maximum of a slot count for the whole slot. Timestamps are monotonic
+// milliseconds.
+class ZwaveValueHistory
+{
+public:
+    enum Window {
+        WindowShort, // 1 minute
+        WindowLong,  // 15 minutes
+        WindowCount
+    };
+
+    static const int capacity = 256;
+
+    static qint64 windowLength(Window window);
+    static qint64 resolution();
+
+    void addSample(qint64 timestamp, double value);
+    // Returns true if the windows moved on, the aggregates may have changed
+    bool expire(qint64 now);
+
+    // Slots in use, a slot holds one or more samples
+    int count() const;
+    int count(Window window) const;
+
+    double average(Window window) const;
+    double minimum(Window window) const;
+    double maximum(Window window) const;
+
+private:
+    static const quint64 mask = capacity - 1;
+    static_assert((capacity & (capacity - 1)) == 0, "The capacity must be a power of two");
+
+    struct Slot {
+        qint64 start;   // First sample
+        qint64 end;     // Last sample
+        double value;   // Last sample, it holds until the next slot starts
+        double minimum;
+        double maximum;
+        double area;    // Integral of the samples from start to end
+    };
+
+    struct WindowState {
+        quint64 first = 0;
+        double area = 0; // Integral of all slots except the newest one
+        // Slots which can still become the minimum or maximum
+        quint16 minimumSlots[capacity];
+        quint16 maximumSlots[capacity];
+        quint64 minimumHead = 0;
+        quint64 minimumTail = 0;
+        quint64 maximumHead = 0;
+        quint64 maximumTail = 0;
+    };
+
+    double area(quint64 sequence, qint64 until) const;
+    void insert(WindowState &state, quint16 slot);
+    void trim(WindowState &state, qint64 start);
+    void evict(WindowState &state);
+
+    Slot m_slots[capacity];
+    WindowState m_windows[WindowCount];
+    quint64 m_next = 0;
+    qint64 m_now = 0;
+};
+
+#endif // ZWAVEVALUEHISTORY_H